@@ -305,7 +305,7 @@ def spine_export(file: str):
 
                         if "type" in spine_object["skins"][i]["attachments"][attachment][subattachment] \
                                 and spine_object["skins"][i]["attachments"][attachment][subattachment]["type"] == "boundingbox":
-                            if bbname == "walkable_area":  # No scripts for navmeshes
+                            if bbname in ("walkable_area", "walkable_hole", "blocking_area"):  # No scripts for navmeshes
                                 continue
                             if not bbname.startswith("dlg:") and not os.path.exists(f"./data-src/scripts/{bbname}.lua"):
                                 if not os.path.exists("./data-src/scripts/"):
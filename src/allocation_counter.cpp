@@ -0,0 +1,47 @@
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<size_t> globalAllocations{0};
+} // namespace
+
+size_t getGlobalAllocationCount()
+{
+    return globalAllocations.load(std::memory_order_relaxed);
+}
+
+bool isAllocationCounterEnabled()
+{
+#ifdef PAC_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef PAC_COUNT_ALLOCATIONS
+// The array and nothrow versions call these by default
+void *operator new(std::size_t size)
+{
+    globalAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
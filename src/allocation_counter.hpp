@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+
+/// Number of calls to the global operator new since the start of the program.
+/// Only counts if the game was built with PAC_COUNT_ALLOCATIONS, otherwise always 0.
+size_t getGlobalAllocationCount();
+
+bool isAllocationCounterEnabled();
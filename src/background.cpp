@@ -3,15 +3,56 @@
 #include "skeleton_drawable.hpp"
 #include "game.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <limits>
+#include <map>
 
-Background::Background(std::shared_ptr<Game> game, const std::string &spine_file) : SpineObject(game, spine_file, "Background")
+namespace
 {
-    spSkeleton_updateWorldTransform(skeleton->skeleton);
-    spSkeletonBounds_update(bounds, skeleton->skeleton, true);
+    struct CachedNavMesh
+    {
+        /// walkableAreaHash() of the pose the navmesh was built from
+        uint64_t sourceHash;
+        std::shared_ptr<const NavMesh> navMesh;
+    };
+    /// One navmesh per skeleton and skin, from the pose the background was created with
+    std::map<std::string, CachedNavMesh> navMeshCache;
 
-    corners = getCorners();
+    constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+    bool containsPoint(const NavMesh::Polygon &polygon, jngl::Vec2 point)
+    {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+        {
+            const auto &a = polygon[i];
+            const auto &b = polygon[j];
+            if ((a.y > point.y) != (b.y > point.y) && point.x < (b.x - a.x) * (point.y - a.y) / (b.y - a.y) + a.x)
+            {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    void hashBytes(uint64_t &hash, const void *data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<const unsigned char *>(data)[i];
+            hash *= 1099511628211ull;
+        }
+    }
+} // namespace
+
+Background::Background(std::shared_ptr<Game> game, const std::string &spine_file) : SpineObject(game, spine_file, "Background"),
+                                                                                    WALK_MASK_CELL_SIZE(game->config["walk_mask_cell_size"].as<double>(4.0))
+{
+    buildNavMesh();
 }
 
 Background::~Background()
@@ -20,10 +61,23 @@ Background::~Background()
 
 bool Background::step(bool force)
 {
-    skeleton->step();
-    spSkeleton_updateWorldTransform(skeleton->skeleton);
-    spSkeletonBounds_update(bounds, skeleton->skeleton, true);
-
+    // Rasterizing every pose would cost more than the exact tests it saves
+    if (!interactableRegionsAnimated && interactableRegionsHash() != interactableMaskSourceHash)
+    {
+        interactableRegionsAnimated = true;
+        interactableMask = WalkMask();
+    }
+    // The walkable area can be animated
+    if (walkableAreaHash() != navMeshSourceHash)
+    {
+        walkableAreaAnimated = true;
+        buildNavMesh();
+        if (auto _game = game.lock())
+        {
+            _game->getPathCache()->clear();
+        }
+    }
+    updateObstacles();
     return stepClickableRegions(force) || deleted;
 }
 
@@ -38,7 +92,7 @@ bool Background::stepClickableRegions(bool force)
             return false;
 
         jngl::Vec2 mousePos = _game->pointer->getPosition();
-        auto collision = spine::spSkeletonBounds_containsPointNotMatchingName(bounds, "walkable_area", (float)mousePos.x - (float)position.x, (float)mousePos.y - (float)position.y);
+        auto collision = spine::spSkeletonBounds_containsInteractablePoint(bounds, (float)mousePos.x - (float)position.x, (float)mousePos.y - (float)position.y);
         // TODO Double Click on Regions
         if (_game->pointer->primaryPressed() && !_game->pointer->isPrimaryAlreadyHandled() && bool(collision))
         {
@@ -73,11 +127,17 @@ void Background::draw() const
     {
         if(_game->enableDebugDraw)
         {
-            jngl::setColor(255, 0, 0);
-            for (size_t i = 0; i < corners.size(); i++)
+            if (navMesh)
             {
-                if (hasPathTo(_game->player->getPosition(), corners.at(i)))
-                    jngl::drawLine(_game->player->getPosition(), corners.at(i));
+                jngl::setColor(0, 128, 255);
+                const auto &vertices = navMesh->getVertices();
+                for (const auto &triangle : navMesh->getTriangles())
+                {
+                    for (size_t i = 0; i < 3; i++)
+                    {
+                        jngl::drawLine(vertices[triangle.vertices[i]], vertices[triangle.vertices[(i + 1) % 3]]);
+                    }
+                }
             }
 
             jngl::setColor(255, 255, 0);
@@ -98,43 +158,8 @@ void Background::draw() const
     jngl::popMatrix();
 }
 
-// Quelle: https://www.youtube.com/watch?v=c065KoXooSw
-bool lineIntersection(jngl::Vec2 a, jngl::Vec2 b, jngl::Vec2 c, jngl::Vec2 d)
-{
-    jngl::Vec2 r = (b - a);
-    jngl::Vec2 s = (d - c);
-
-    double e = r.x * s.y - r.y * s.x;
-    double u = ((c.x - a.x) * r.y - (c.y - a.y) * r.x) / e;
-    double t = ((c.x - a.x) * s.y - (c.y - a.y) * s.x) / e;
-
-    // Intersection Point a + t * r
-    // Expand line with 0.01 to get right resault on corners
-    return (-0.01 <= u && u <= 1.01 && -0.01 <= t && t <= 1.01);
-}
-
-Node::Node(jngl::Vec2 coordinates_, Node *parent_): coordinates(coordinates_)
-{
-    parent = parent_;
-    G = H = 0;
-}
-
-int Node::getScore()
-{
-    return G + H;
-}
-
 std::deque<jngl::Vec2> Background::getPathToTarget(jngl::Vec2 start, jngl::Vec2 target) const
 {
-    // Debug Positions
-    //     start = {
-    // -595.38133024921717,
-    // 264.28874734607211};
-    //     target = {
-    // 550.99726190217416,
-    // 511.59235668789813
-    //         };
-
     std::deque<jngl::Vec2> path;
 
     if (!is_walkable(target))
@@ -142,170 +167,306 @@ std::deque<jngl::Vec2> Background::getPathToTarget(jngl::Vec2 start, jngl::Vec2
         return path;
     }
 
-    Node *current = nullptr;
-    std::vector<Node *> openSet, closedSet;
-
-    openSet.push_back(new Node(start));
-
-    while (!openSet.empty())
+    // Without a walkable_area there is nowhere to go
+    if (!navMesh || navMesh->empty())
     {
-        auto current_it = openSet.begin();
-        current = *current_it;
-
-        for (auto it = openSet.begin(); it != openSet.end(); it++)
-        {
-            auto node = *it;
-            if (node->getScore() <= current->getScore())
-            {
-                current = node;
-                current_it = it;
-            }
-        }
+        return path;
+    }
+    auto _game = game.lock();
+    if (_game && _game->getPathCache()->find(start, target, navMesh->getVersion(), path))
+    {
+        return path;
+    }
+    path = navMesh->findPath(start, target);
+    if (_game)
+    {
+        _game->getPathCache()->insert(start, target, navMesh->getVersion(), path);
+    }
+    return path;
+}
 
-        if (current->coordinates == target)
-        {
-            break;
-        }
+void Background::requestPathToTarget(jngl::Vec2 start, jngl::Vec2 target, std::function<void(std::deque<jngl::Vec2>)> onPath) const
+{
+    auto _game = game.lock();
+    if (!_game)
+    {
+        return;
+    }
+    // The bounds belong to the main thread, only the navmesh is shared with the worker
+    if (!is_walkable(target) || !navMesh || navMesh->empty())
+    {
+        _game->getJobSystem()->runOnMainThread([onPath = std::move(onPath), path = getPathToTarget(start, target)]()
+                                               { onPath(path); });
+        return;
+    }
+    PathCache *pathCache = _game->getPathCache();
+    std::deque<jngl::Vec2> cachedPath;
+    if (pathCache->find(start, target, navMesh->getVersion(), cachedPath))
+    {
+        _game->getJobSystem()->runOnMainThread([onPath = std::move(onPath), path = std::move(cachedPath)]()
+                                               { onPath(path); });
+        return;
+    }
+    _game->getJobSystem()->submitThen([navMesh = navMesh, start, target]()
+                                      { return navMesh->findPath(start, target); },
+                                      [pathCache, version = navMesh->getVersion(), start, target, onPath = std::move(onPath)](std::exception_ptr error, std::deque<jngl::Vec2> path)
+                                      {
+                                          if (error)
+                                          {
+                                              // Like an unreachable target, the agent doesn't walk
+                                              jngl::debugLn("Path finding failed");
+                                              onPath({});
+                                              return;
+                                          }
+                                          pathCache->insert(start, target, version, path);
+                                          onPath(std::move(path));
+                                      });
+}
 
-        closedSet.push_back(current);
-        openSet.erase(current_it);
+void Background::buildNavMesh()
+{
+    spSkeleton_updateWorldTransform(skeleton->skeleton);
+    spSkeletonBounds_update(bounds, skeleton->skeleton, true);
 
-        // auto directions = getDirections(current->coordinates);
-        auto directions = corners;
-        directions.push_back(target);
-        for (size_t i = 0; i < directions.size(); ++i)
+    navMeshSourceHash = walkableAreaHash();
+    // The cached navmesh has no obstacles, updateObstacles adds them again
+    obstacles.clear();
+    obstacleHash = FNV_OFFSET_BASIS;
+    const spSkin *skin = skeleton->skeleton->skin;
+    const std::string key = spine_name + "/" + (skin ? skin->name : "default");
+    auto cached = navMeshCache.find(key);
+    if (cached != navMeshCache.end() && cached->second.sourceHash == navMeshSourceHash)
+    {
+        navMesh = cached->second.navMesh;
+    }
+    else
+    {
+        std::vector<NavMesh::Polygon> areas;
+        std::vector<NavMesh::Polygon> holes;
+        for (int iPoly = 0; iPoly < bounds->count; iPoly++)
         {
-            bool hastpath = !hasPathTo(current->coordinates, directions[i]);
-            auto visited = findNodeOnList(closedSet, directions[i]);
-
-            if (hastpath || visited)
+            const std::string polygonName = bounds->boundingBoxes[iPoly]->super.super.name;
+            if (polygonName != "walkable_area" && polygonName != "walkable_hole")
             {
                 continue;
             }
-
-            int totalCost = current->G + heuristic(current->coordinates, directions[i]);
-
-            Node *successor = findNodeOnList(openSet, directions[i]);
-            if (successor == nullptr)
+            NavMesh::Polygon polygon;
+            for (int i = 0; i < bounds->polygons[iPoly]->count; i += 2)
             {
-                successor = new Node(directions[i], current);
-                successor->G = totalCost;
-                successor->H = heuristic(successor->coordinates, target);
-                openSet.push_back(successor);
-            }
-            else if (totalCost < successor->G)
-            {
-                successor->parent = current;
-                successor->G = totalCost;
+                polygon.emplace_back(bounds->polygons[iPoly]->vertices[i], bounds->polygons[iPoly]->vertices[i + 1]);
             }
+            (polygonName == "walkable_area" ? areas : holes).push_back(std::move(polygon));
+        }
+        navMesh = std::make_shared<const NavMesh>(areas, holes);
+        // Every pose of an animated walkable area would be a new entry
+        if (!walkableAreaAnimated)
+        {
+            navMeshCache[key] = {navMeshSourceHash, navMesh};
         }
     }
 
-    while (current != nullptr)
+    buildWalkableMask();
+    // E.g. after the skin changed
+    if (!interactableRegionsAnimated && interactableRegionsHash() != interactableMaskSourceHash)
     {
-        path.emplace_front(current->coordinates);
-        current = current->parent;
+        buildInteractableMask();
     }
+}
 
-    releaseNodes(openSet);
-    releaseNodes(closedSet);
-
-    return path;
+uint64_t Background::walkableAreaHash() const
+{
+    // FNV-1a over the names and vertices of the walkable bounding boxes
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (int iPoly = 0; iPoly < bounds->count; iPoly++)
+    {
+        const char *polygonName = bounds->boundingBoxes[iPoly]->super.super.name;
+        if (polygonName != std::string("walkable_area") && polygonName != std::string("walkable_hole"))
+        {
+            continue;
+        }
+        hashBytes(hash, polygonName, std::strlen(polygonName));
+        hashBytes(hash, bounds->polygons[iPoly]->vertices, sizeof(float) * bounds->polygons[iPoly]->count);
+    }
+    return hash;
 }
 
-void Background::releaseNodes(std::vector<Node *> &nodes_) const
+uint64_t Background::interactableRegionsHash() const
 {
-    for (auto it = nodes_.begin(); it != nodes_.end();)
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (int iPoly = 0; iPoly < bounds->count; iPoly++)
     {
-        delete *it;
-        it = nodes_.erase(it);
+        const char *polygonName = bounds->boundingBoxes[iPoly]->super.super.name;
+        if (!spine::isInteractableBoundingBox(polygonName))
+        {
+            continue;
+        }
+        hashBytes(hash, polygonName, std::strlen(polygonName));
+        hashBytes(hash, bounds->polygons[iPoly]->vertices, sizeof(float) * bounds->polygons[iPoly]->count);
     }
+    return hash;
 }
 
-Node *Background::findNodeOnList(const std::vector<Node *> &nodes_, jngl::Vec2 coordinates_) const
+void Background::updateObstacles()
 {
-    for (auto node : nodes_)
+    auto _game = game.lock();
+    if (!_game || !navMesh)
+    {
+        return;
+    }
+
+    // Rounded, so that small movements don't triangulate again
+    constexpr double OBSTACLE_GRID = 4;
+    uint64_t hash = FNV_OFFSET_BASIS;
+    size_t count = 0;
+    for (const auto &obj : _game->gameObjects)
     {
-        if (node->coordinates == coordinates_)
+        if (obj.get() == this || obj == _game->player || !obj->bounds || !obj->getVisible())
         {
-            return node;
+            continue;
+        }
+        const auto *objBounds = obj->bounds;
+        for (int iPoly = 0; iPoly < objBounds->count; iPoly++)
+        {
+            if (objBounds->boundingBoxes[iPoly]->super.super.name != std::string("blocking_area"))
+            {
+                continue;
+            }
+            if (count == obstacles.size())
+            {
+                obstacles.emplace_back();
+            }
+            auto &obstacle = obstacles[count++];
+            obstacle.clear();
+            const jngl::Vec2 objPosition = obj->getPosition();
+            // Objects are drawn rotated around their position
+            const double angle = obj->getRotation() * M_PI / 180.0;
+            const double cosAngle = std::cos(angle);
+            const double sinAngle = std::sin(angle);
+            for (int i = 0; i < objBounds->polygons[iPoly]->count; i += 2)
+            {
+                const double x = objBounds->polygons[iPoly]->vertices[i];
+                const double y = objBounds->polygons[iPoly]->vertices[i + 1];
+                const jngl::Vec2 point(std::round((objPosition.x + x * cosAngle - y * sinAngle) / OBSTACLE_GRID) * OBSTACLE_GRID,
+                                       std::round((objPosition.y + x * sinAngle + y * cosAngle) / OBSTACLE_GRID) * OBSTACLE_GRID);
+                obstacle.push_back(point);
+                hashBytes(hash, &point, sizeof(point));
+            }
+            hashBytes(hash, &count, sizeof(count));
         }
     }
-    return nullptr;
+    obstacles.resize(count);
+    if (hash == obstacleHash)
+    {
+        return;
+    }
+    obstacleHash = hash;
+    // Only the areas with changed obstacles are triangulated again
+    navMesh = std::make_shared<const NavMesh>(*navMesh, obstacles);
+    _game->getPathCache()->clear();
 }
 
-int Background::heuristic(jngl::Vec2 start, jngl::Vec2 target) const
+void Background::clearNavMeshCache()
 {
-    return std::sqrt((start.x - target.x) * (start.x - target.x) + (start.y - target.y) * (start.y - target.y));
+    navMeshCache.clear();
 }
 
-bool Background::hasPathTo(jngl::Vec2 start, jngl::Vec2 target) const
+bool Background::is_walkable(jngl::Vec2 position) const
 {
-    int count = 0;
-    for (size_t i = 0; i < corners.size() - 1; i++)
+    if (!isInWalkableArea(position))
+        return false;
+
+    // The navmesh has holes for the blocking_area of objects
+    for (const auto &obstacle : obstacles)
     {
-        if (lineIntersection(start, target, corners.at(i), corners.at(i + 1)))
-            count++;
+        if (obstacle.size() >= 3 && containsPoint(obstacle, position))
+        {
+            return false;
+        }
     }
 
-    bool corner = false;
-
-    if (std::any_of(corners.cbegin(), corners.cend(), [&target](jngl::Vec2 corn)
-                    { return corn == target; }))
+    // if there is an interactable region and a walkable spot,
+    // just interact, don't walk there
+    if (interactableRegionsAnimated)
     {
-        corner = true;
+        return !spine::spSkeletonBounds_containsInteractablePoint(bounds, (float)position.x, (float)position.y);
     }
-
-    // TODO Clean up. Can be moved into first loop.
-    bool startcorner = false;
-    if (std::any_of(corners.cbegin(), corners.cend(), [&start](jngl::Vec2 corn)
-                    { return corn == start; }))
+    switch (interactableMask.lookup(position))
     {
-        startcorner = true;
+    case WalkMask::Result::Inside:
+        return false;
+    case WalkMask::Result::Outside:
+        return true;
+    default:
+        return !spine::spSkeletonBounds_containsInteractablePoint(bounds, (float)position.x, (float)position.y);
     }
+}
 
-    if (startcorner && count <= 2)
+bool Background::isInWalkableArea(jngl::Vec2 position) const
+{
+    switch (walkableMask.lookup(position))
     {
+    case WalkMask::Result::Inside:
         return true;
+    case WalkMask::Result::Outside:
+        return false;
+    default:
+        return isInWalkableAreaExact(position);
     }
+}
 
-    return (corner && count <= 2) || (!corner && count == 0);
+bool Background::isInWalkableAreaExact(jngl::Vec2 position) const
+{
+    auto walkableResult = spine::spSkeletonBounds_containsPointMatchingName(bounds, "walkable_area", (float)position.x, (float)position.y);
+    if(!walkableResult)
+        return false;
+
+    return !spine::spSkeletonBounds_containsPointMatchingName(bounds, "walkable_hole", (float)position.x, (float)position.y);
 }
 
-std::vector<jngl::Vec2> Background::getCorners() const
+void Background::buildWalkableMask()
 {
-    std::vector<jngl::Vec2> result;
-    if (bounds->count == 0)
-    {
-        return result;
-    }
+    std::vector<WalkMask::Polygon> areas;
+    std::vector<WalkMask::Polygon> walkableEdges;
     for (int iPoly = 0; iPoly < bounds->count; iPoly++)
     {
-        auto polygonName = bounds->boundingBoxes[iPoly]->super.super.name;
-        if(polygonName == std::string("walkable_area"))
+        const std::string polygonName = bounds->boundingBoxes[iPoly]->super.super.name;
+        if (polygonName != "walkable_area" && polygonName != "walkable_hole")
         {
-            // bounds->polygons
-            for (int i = 0; i < (bounds->polygons[iPoly])->count; i += 2)
-            {
-                result.push_back(jngl::Vec2((bounds->polygons[iPoly])->vertices[i + 0], (bounds->polygons[iPoly])->vertices[i + 1]));
-            }
-            // Add first to the back again.
-            result.push_back(jngl::Vec2((bounds->polygons[iPoly])->vertices[0], (bounds->polygons[iPoly])->vertices[1]));
-            break;
+            continue;
         }
+        WalkMask::Polygon polygon;
+        for (int i = 0; i < bounds->polygons[iPoly]->count; i += 2)
+        {
+            polygon.emplace_back(bounds->polygons[iPoly]->vertices[i], bounds->polygons[iPoly]->vertices[i + 1]);
+        }
+        if (polygonName == "walkable_area")
+        {
+            areas.push_back(polygon);
+        }
+        walkableEdges.push_back(std::move(polygon));
     }
-
-    return result;
+    walkableMask = WalkMask(areas, walkableEdges, WALK_MASK_CELL_SIZE,
+                            [this](jngl::Vec2 position) { return isInWalkableAreaExact(position); });
 }
 
-bool Background::is_walkable(jngl::Vec2 position) const
+void Background::buildInteractableMask()
 {
-    auto walkableResult = spine::spSkeletonBounds_containsPointMatchingName(bounds, "walkable_area", (float)position.x, (float)position.y);
-    if(!walkableResult)
-        return false;
-
-    // if there is an interactable region and a walkable spot,
-    // just interact, don't walk there
-    auto interactableResult = spine::spSkeletonBounds_containsPointNotMatchingName(bounds, "walkable_area", (float)position.x, (float)position.y);
-    return !interactableResult;
+    std::vector<WalkMask::Polygon> interactables;
+    for (int iPoly = 0; iPoly < bounds->count; iPoly++)
+    {
+        if (!spine::isInteractableBoundingBox(bounds->boundingBoxes[iPoly]->super.super.name))
+        {
+            continue;
+        }
+        WalkMask::Polygon polygon;
+        for (int i = 0; i < bounds->polygons[iPoly]->count; i += 2)
+        {
+            polygon.emplace_back(bounds->polygons[iPoly]->vertices[i], bounds->polygons[iPoly]->vertices[i + 1]);
+        }
+        interactables.push_back(std::move(polygon));
+    }
+    interactableMask = WalkMask(interactables, interactables, WALK_MASK_CELL_SIZE,
+                                [this](jngl::Vec2 position)
+                                { return spine::spSkeletonBounds_containsInteractablePoint(bounds, (float)position.x, (float)position.y) != nullptr; });
+    interactableMaskSourceHash = interactableRegionsHash();
 }
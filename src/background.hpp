@@ -1,22 +1,15 @@
 #pragma once
 
 #include "spine_object.hpp"
+#include "navmesh.hpp"
+#include "walk_mask.hpp"
 
 #include <array>
 #include <jngl.hpp>
 #include <list>
 #include <map>
 #include <deque>
-
-struct Node
-{
-    int G, H;
-    jngl::Vec2 coordinates;
-    Node *parent;
-
-    explicit Node(jngl::Vec2 coord_, Node *parent_ = nullptr);
-    int getScore();
-};
+#include <functional>
 
 class Background : public SpineObject
 {
@@ -24,19 +17,55 @@ public:
     explicit Background(std::shared_ptr<Game> game, const std::string &spine_file);
     ~Background();
 
+    /// Inside of the walkable area and not on an interactable region or the blocking_area of an object
     bool is_walkable(jngl::Vec2 position) const;
+    /// Inside of a walkable_area and outside of the walkable_holes
+    bool isInWalkableArea(jngl::Vec2 position) const;
     bool step(bool force = false) override;
     void draw() const override;
 
+    /// Path over the navmesh from start to target including both, empty if target can't be reached
     std::deque<jngl::Vec2> getPathToTarget(jngl::Vec2 start, jngl::Vec2 target) const;
+    /// Like getPathToTarget, but the navmesh is searched on a worker of the job system.
+    /// onPath is called on the main thread during one of the next steps.
+    void requestPathToTarget(jngl::Vec2 start, jngl::Vec2 target, std::function<void(std::deque<jngl::Vec2>)> onPath) const;
+
+    /// Collects the walkable_area and walkable_hole polygons of the current skin and triangulates them.
+    /// Navmeshes are cached per skeleton and skin, so revisiting a scene doesn't triangulate again.
+    /// Only the pose the background was created with is cached, not the poses of an animated walkable area.
+    /// Also rebuilds the masks is_walkable looks up.
+    void buildNavMesh();
+    std::shared_ptr<const NavMesh> getNavMesh() const { return navMesh; }
+    static void clearNavMeshCache();
 
 private:
-    std::vector<jngl::Vec2> corners;
+    const double WALK_MASK_CELL_SIZE;
+
+    std::shared_ptr<const NavMesh> navMesh;
+    /// walkableAreaHash() of the polygons the navmesh was built from
+    uint64_t navMeshSourceHash = 0;
+    /// Set when the walkable area changed after the background was created, its poses aren't cached
+    bool walkableAreaAnimated = false;
+    /// blocking_area polygons of the objects in the scene, in scene coordinates
+    std::vector<NavMesh::Polygon> obstacles;
+    uint64_t obstacleHash = 0;
+    /// Rasterized walkable areas and interactable regions for is_walkable
+    WalkMask walkableMask;
+    WalkMask interactableMask;
+    /// interactableRegionsHash() of the polygons interactableMask was built from
+    uint64_t interactableMaskSourceHash = 0;
+    /// Set when the interactable regions changed after the background was created, is_walkable
+    /// tests them exactly then
+    bool interactableRegionsAnimated = false;
 
     bool stepClickableRegions(bool force = false);
-    std::vector<jngl::Vec2> getCorners() const;
-    bool hasPathTo(jngl::Vec2 start, jngl::Vec2 target) const;
-    void releaseNodes(std::vector<Node *> &nodes_) const;
-    Node *findNodeOnList(const std::vector<Node *> &nodes_, jngl::Vec2 coordinates_) const;
-    int heuristic(jngl::Vec2 start, jngl::Vec2 target) const;
+    uint64_t walkableAreaHash() const;
+    uint64_t interactableRegionsHash() const;
+    /// Called by buildNavMesh, which runs whenever the walkable polygons change
+    void buildWalkableMask();
+    void buildInteractableMask();
+    /// Polygon tests for the cells of the masks an edge runs through
+    bool isInWalkableAreaExact(jngl::Vec2 position) const;
+    /// Adds the blocking_area of objects as obstacles to the navmesh if they moved, appeared or vanished
+    void updateObstacles();
 };
@@ -0,0 +1,69 @@
+#include "depth_map.hpp"
+
+#include <jngl/ImageData.hpp>
+#include <jngl/debug.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+DepthMap::DepthMap(const std::string &filename, int cellSize) : cellSize(std::max(cellSize, 1))
+{
+    const auto image = jngl::ImageData::load(filename);
+    if (!image || image->getWidth() <= 0 || image->getHeight() <= 0)
+    {
+        jngl::debugLn("Could not load the zBufferMap " + filename);
+        return;
+    }
+    const int width = image->getWidth();
+    const int height = image->getHeight();
+    const uint8_t *pixels = image->pixels();
+    const int size = std::max(cellSize, 1);
+    columns = (width + size - 1) / size;
+    rows = (height + size - 1) / size;
+    origin = jngl::Vec2(-width / 2.0, -height / 2.0);
+
+    // Average of the red channel over every cell, the map is expected to be grayscale
+    grid.resize(size_t(columns) * rows);
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            unsigned int sum = 0;
+            unsigned int count = 0;
+            for (int y = row * size; y < std::min((row + 1) * size, height); ++y)
+            {
+                for (int x = column * size; x < std::min((column + 1) * size, width); ++x)
+                {
+                    sum += pixels[(size_t(y) * width + x) * 4];
+                    ++count;
+                }
+            }
+            grid[size_t(row) * columns + column] = uint8_t(sum / count);
+        }
+    }
+}
+
+float DepthMap::at(int column, int row) const
+{
+    column = std::clamp(column, 0, columns - 1);
+    row = std::clamp(row, 0, rows - 1);
+    return grid[size_t(row) * columns + column] / 255.f;
+}
+
+float DepthMap::sample(jngl::Vec2 position) const
+{
+    if (grid.empty())
+    {
+        return 0;
+    }
+    // Grid values belong to the centers of their cells
+    const double x = (position.x - origin.x) / cellSize - 0.5;
+    const double y = (position.y - origin.y) / cellSize - 0.5;
+    const int column = int(std::floor(x));
+    const int row = int(std::floor(y));
+    const float fx = float(x - column);
+    const float fy = float(y - row);
+    const float top = at(column, row) * (1 - fx) + at(column + 1, row) * fx;
+    const float bottom = at(column, row + 1) * (1 - fx) + at(column + 1, row + 1) * fx;
+    return top * (1 - fy) + bottom * fy;
+}
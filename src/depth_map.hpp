@@ -0,0 +1,31 @@
+#pragma once
+
+#include <jngl/Vec2.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Grayscale depth image of a scene (zBufferMap), decoded once into a downsampled grid on the CPU.
+/// Bright pixels are near the camera, dark ones far away.
+class DepthMap
+{
+public:
+    /// cellSize: edge length in pixels of the squares averaged into one grid value
+    DepthMap(const std::string &filename, int cellSize);
+
+    /// Depth at a position in scene coordinates from 0 (far) to 1 (near), bilinearly interpolated.
+    /// The image is centered on the scene's origin like the background.
+    float sample(jngl::Vec2 position) const;
+
+    bool empty() const { return grid.empty(); }
+
+private:
+    float at(int column, int row) const;
+
+    std::vector<uint8_t> grid;
+    int columns = 0;
+    int rows = 0;
+    double cellSize = 1;
+    jngl::Vec2 origin;
+};
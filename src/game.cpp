@@ -11,6 +11,8 @@
 #include <spine/spine.h>
 #include "pointer.hpp"
 #include "interactable_object.hpp"
+#include "allocation_counter.hpp"
+#include "spine_allocator.hpp"
 
 #if (!defined(NDEBUG) && !defined(ANDROID) && !defined(EMSCRIPTEN))
 #include "FileWatch.hpp"
@@ -20,8 +22,17 @@
 using jngl::Vec2;
 using namespace std::string_literals;
 
-Game::Game(YAML::Node config) : config(config), cameraPosition(jngl::Vec2(0,0)), targetCameraPosition(jngl::Vec2(0,0))
+Game::Game(YAML::Node config) : config(config), cameraPosition(jngl::Vec2(0,0)), targetCameraPosition(jngl::Vec2(0,0)),
+	ANIMATION_LOD_MARGIN(config["animation_lod_margin"].as<double>(200.0)),
+	ANIMATION_LOD_DISTANCE(config["animation_lod_distance"].as<double>(0.0)),
+	ANIMATION_LOD_ZOOM(config["animation_lod_zoom"].as<double>(0.0)),
+	LUA_GC_BUDGET(config["lua_gc_budget_us"].as<double>(1000.0)),
+	LUA_GC_OVERDUE_BUDGET(config["lua_gc_overdue_budget_us"].as<double>(4000.0)),
+	pathCache(config["path_cache_size"].as<size_t>(256), config["path_cache_quantization"].as<double>(4.0))
 {
+	// Before the first skeleton is loaded, spine-c must not free blocks it got from malloc
+	installSpineAllocator();
+
 	auto screensize = jngl::getScreenSize();
 	auto zoomx = this->config["screenSize"]["x"].as<int>() / screensize.x;
 	auto zoomy = this->config["screenSize"]["y"].as<int>() / screensize.y;
@@ -62,6 +73,11 @@ Game::Game(YAML::Node config) : config(config), cameraPosition(jngl::Vec2(0,0)),
 	// open some common libraries
 	lua_state = std::make_shared<sol::state>();
 	lua_state->open_libraries(sol::lib::base, sol::lib::package);
+	if (LUA_GC_BUDGET > 0)
+	{
+		// Collected in stepLuaGarbageCollector and on scene loads instead of in the middle of a script
+		lua_gc(lua_state->lua_state(), LUA_GCSTOP, 0);
+	}
 
 #if (!defined(NDEBUG) && !defined(ANDROID) && !defined(EMSCRIPTEN))
 #ifdef _WIN32
@@ -117,6 +133,8 @@ void Game::loadLevel(const std::string &level)
 	dialogManager->cancelDialog();
 
 	// Clear the level if there is already a level loaded
+	// The state tables of the old scene's items stay, but must not keep the deleted objects alive
+	sol::optional<sol::table> oldItems = (*lua_state)["scenes"][old_scene]["items"];
 	for (auto it = gameObjects.begin(); it != gameObjects.end();)
 	{
 		if ((*it)->cross_scene)
@@ -126,9 +144,16 @@ void Game::loadLevel(const std::string &level)
 		else
 		{
 			(*it)->setDeleted();
+			objectsById.erase((*it)->getId());
+			if (oldItems && (*oldItems)[(*it)->getId()].valid())
+			{
+				(*oldItems)[(*it)->getId()]["object"] = sol::lua_nil;
+			}
 			++it;
 		}
 	}
+	// The non-persistent variables of the old scene become garbage
+	createSceneEnvironment();
 	auto newScene = std::make_shared<Scene>(level, shared_from_this());
 	if(!newScene->background)
 	{
@@ -138,6 +163,8 @@ void Game::loadLevel(const std::string &level)
 
 	currentScene = newScene;
 	currentScene->playMusic();
+	// The skin of the background is set after it was created
+	triangulateBorder();
 
 	// Pointer should be last in gameObjects so it's on top
 	if (pointer == nullptr)
@@ -155,6 +182,88 @@ void Game::loadLevel(const std::string &level)
 	}
 	player->stop_walking();
 	setCameraPositionImmediately(player->calcCamPos());
+
+	// The tables of the old scene are garbage now, a loading screen hides the pause
+	lua_state->collect_garbage();
+	luaHeapAfterCycle = lua_state->memory_used();
+}
+
+void Game::createSceneEnvironment()
+{
+	if (!sceneEnvironmentMetatable.valid())
+	{
+		sol::function createMetatable = lua_state->script(R"(
+			return function(dropped, warn)
+				local metatable = {
+					__index = _G,
+					__newindex = function(environment, key, value)
+						local persisted = rawget(_G, "persisted_variables")
+						if rawget(_G, key) ~= nil or (persisted and persisted[key]) then
+							_G[key] = value
+						else
+							rawset(environment, key, value)
+						end
+					end,
+				}
+				if dropped then
+					metatable.__index = function(environment, key)
+						local value = _G[key]
+						if value == nil and dropped[key] then
+							warn(key, dropped[key])
+							dropped[key] = nil
+						end
+						return value
+					end
+				end
+				return metatable
+			end
+		)");
+#ifndef NDEBUG
+		// Scripts written before the scene environments expect every variable to be global
+		droppedSceneVariables = lua_state->create_table();
+		sceneEnvironmentMetatable = createMetatable(droppedSceneVariables, [](const std::string &name, const std::string &scene)
+		{
+			jngl::debugLn("Warning: " + name + " was dropped when the scene " + scene + " was left. Use Persist(\"" + name +
+			              "\") to keep it.");
+		});
+#else
+		sceneEnvironmentMetatable = createMetatable(sol::lua_nil, sol::lua_nil);
+#endif
+	}
+#ifndef NDEBUG
+	if (sceneEnvironment.valid() && currentScene)
+	{
+		const std::string scene = currentScene->getSceneName();
+		sceneEnvironment.for_each([this, &scene](const sol::object &key, const sol::object &)
+		{
+			if (key.get_type() == sol::type::string)
+			{
+				droppedSceneVariables[key] = scene;
+			}
+		});
+	}
+#endif
+	if (!(*lua_state)["persisted_variables"].valid())
+	{
+		(*lua_state)["persisted_variables"] = lua_state->create_table();
+	}
+	sceneEnvironment = sol::environment(*lua_state, sol::create);
+	sceneEnvironment[sol::metatable_key] = sceneEnvironmentMetatable;
+}
+
+void Game::persist(const std::string &name)
+{
+	(*lua_state)["persisted_variables"][name] = true;
+	if (!sceneEnvironment.valid())
+	{
+		return;
+	}
+	sol::object value = sceneEnvironment.raw_get<sol::object>(name);
+	if (value.valid())
+	{
+		lua_state->globals().raw_set(name, value);
+		sceneEnvironment.raw_set(name, sol::lua_nil);
+	}
 }
 
 Game::~Game()
@@ -170,10 +279,13 @@ Game::~Game()
 
 void Game::step()
 {
+	const size_t allocationsBefore = getGlobalAllocationCount();
+	jobSystem.runMainThreadJobs();
 	addObjects();
 	stepCamera();
 
 	pointer->step();
+	stepAnimations();
 
 	for (auto it = gameObjects.rbegin(); it != gameObjects.rend();)
 	{
@@ -189,9 +301,26 @@ void Game::step()
 		std::advance(it, 1);
 	}
 
+	if (currentScene && currentScene->background)
+	{
+		navCrowd.step(*currentScene->background, jobSystem, player.get());
+	}
+	{
+		LuaProfiler::Scope scope(luaProfiler, "coroutines", "resume");
+		scriptScheduler.step();
+	}
+
 	dialogManager->step();
 
-	// Sort game objects depending on the y position for
+	// Sort game objects by depth for drawing, from the zBufferMap if the scene has one
+	const DepthMap *depthMap = currentScene ? currentScene->getDepthMap() : nullptr;
+	for (auto &obj : gameObjects)
+	{
+		if (obj)
+		{
+			obj->updateZ(depthMap);
+		}
+	}
 	sort(gameObjects.begin(), gameObjects.end(), [](const auto &lhs, const auto &rhs)
 		 { return lhs->getZ() < rhs->getZ(); });
 
@@ -200,6 +329,9 @@ void Game::step()
 #endif
 	pointer->resetHandledFlags();
 	removeObjects();
+	stepLuaGarbageCollector();
+
+	stepAllocations = getGlobalAllocationCount() - allocationsBefore;
 }
 
 // Get current date/time, format is YYYY-MM-DD.HH:mm:ss
@@ -260,6 +392,8 @@ void Game::debugStep()
 		std::this_thread::sleep_for(std::chrono::milliseconds(500));
 		std::string dialogFilePath = config["dialog"].as<std::string>();
 		getDialogManager()->loadDialogsFromFile(dialogFilePath, false);
+		// The walkable areas may have been changed in Spine
+		Background::clearNavMeshCache();
 		loadLevel(currentScene->getSceneName());
 		reload = false;
 	}
@@ -268,6 +402,18 @@ void Game::debugStep()
 	{
 		enableDebugDraw = !enableDebugDraw;
 	}
+	// Lua profiler, the report is written when it's stopped
+	if (jngl::keyPressed(jngl::key::F9))
+	{
+		if (luaProfiler.isEnabled())
+		{
+			luaProfiler.stop("lua_profile.txt");
+		}
+		else
+		{
+			luaProfiler.start(lua_state->lua_state());
+		}
+	}
 	if (jngl::keyPressed(jngl::key::Tab))
 	{
 		editMode = !editMode;
@@ -373,6 +519,7 @@ void Game::debugStep()
 
 void Game::draw() const
 {
+	const size_t allocationsBefore = getGlobalAllocationCount();
 	jngl::pushMatrix();
 	jngl::setBackgroundColor(jngl::Color(0, 0, 0));
 	applyCamera();
@@ -388,6 +535,55 @@ void Game::draw() const
 	// Der Pointer wird doppelt gedrawed, damit der immer vorne ist.
 	pointer->draw();
 	jngl::popMatrix();
+
+	drawAllocations = getGlobalAllocationCount() - allocationsBefore;
+
+#ifndef NDEBUG
+	if (enableDebugDraw)
+	{
+		drawDebugOverlay();
+	}
+#endif
+}
+
+#ifndef NDEBUG
+void Game::drawDebugOverlay() const
+{
+	std::string stats;
+	if (isAllocationCounterEnabled())
+	{
+		stats += "allocations step: " + std::to_string(stepAllocations) + " draw: " + std::to_string(drawAllocations) + "\n";
+	}
+	else
+	{
+		stats += "allocations: build with PAC_COUNT_ALLOCATIONS\n";
+	}
+	stats += "path cache: " + std::to_string(pathCache.getHits()) + " hits, " + std::to_string(pathCache.getMisses()) + " misses, " +
+		std::to_string(pathCache.size()) + " paths\n";
+	stats += "lua gc: " + std::to_string(int(luaGcSeconds * 1e6)) + " us, heap " + std::to_string(lua_state->memory_used() / 1024) + " KiB\n";
+	if (luaProfiler.isEnabled())
+	{
+		stats += "lua profiler: running, F9 writes lua_profile.txt\n";
+	}
+	const auto spineStats = getSpineAllocatorStats();
+	stats += "spine pools: " + std::to_string(spineStats.liveBlocks) + " live, " + std::to_string(spineStats.cachedBlocks) + " cached, " +
+		std::to_string(spineStats.reservedBytes / 1024) + " KiB, " + std::to_string(spineStats.largeAllocations) + " large\n";
+
+	const auto screenSize = jngl::getScreenSize();
+	jngl::Text text;
+	text.setText(stats);
+	text.setPos(-screenSize.x / 2 + 10, -screenSize.y / 2 + 10);
+	jngl::setFontColor(jngl::Color(255, 255, 0));
+	text.draw();
+}
+#endif
+
+void Game::triangulateBorder()
+{
+	if (currentScene && currentScene->background)
+	{
+		currentScene->background->buildNavMesh();
+	}
 }
 
 void Game::applyCamera() const
@@ -460,17 +656,118 @@ void Game::setCameraPositionImmediately(Vec2 position)
 	targetCameraPosition = cameraPosition = position;
 }
 
+void Game::stepLuaGarbageCollector()
+{
+	if (LUA_GC_BUDGET <= 0)
+	{
+		return;
+	}
+	lua_State *lua = lua_state->lua_state();
+	const auto start = std::chrono::steady_clock::now();
+	// If the scripts allocate faster than the budget collects, catch up over the next steps.
+	// The cycle is never finished in one go, only loadLevel collects everything at once.
+	const bool overdue = lua_state->memory_used() > 2 * std::max<size_t>(luaHeapAfterCycle, 1024 * 1024);
+	const auto budget = std::chrono::duration<double, std::micro>(overdue ? std::max(LUA_GC_OVERDUE_BUDGET, LUA_GC_BUDGET) : LUA_GC_BUDGET);
+	while (std::chrono::steady_clock::now() - start < budget)
+	{
+		if (lua_gc(lua, LUA_GCSTEP, 0))
+		{
+			luaHeapAfterCycle = lua_state->memory_used();
+			break;
+		}
+	}
+	luaGcSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
 void Game::stepCamera()
 {
 	const auto speed = getCameraSpeed();
 	cameraPosition += speed / 36.0;
 }
 
+void Game::stepAnimations()
+{
+	const float deltaTime = 1.f / float(jngl::getStepsPerSecond());
+
+	animationUpdates.clear();
+	for (const auto &obj : gameObjects)
+	{
+		// The pointer animates itself at the end of its step
+		if (obj != nullptr && obj != pointer)
+		{
+			animationUpdates.push_back({obj.get(), getAnimationDetail(obj)});
+		}
+	}
+
+	jobSystem.parallelFor(animationUpdates.size(), [this, deltaTime](size_t i)
+						  { animationUpdates[i].object->updateAnimation(deltaTime, animationUpdates[i].detail); });
+
+	// Lua callbacks are only allowed on the main thread. Replaying them in the order of
+	// gameObjects keeps the result independent of the thread scheduling.
+	for (const auto &update : animationUpdates)
+	{
+		update.object->dispatchQueuedEvents();
+	}
+}
+
+AnimationDetail Game::getAnimationDetail(const std::shared_ptr<SpineObject> &obj) const
+{
+	if (obj == player || obj->abs_position || (currentScene && obj == currentScene->background))
+	{
+		return AnimationDetail::Full;
+	}
+	if (!obj->getVisible())
+	{
+		return AnimationDetail::EventsOnly;
+	}
+	// Objects without bounding boxes have an unknown size
+	if (obj->bounds->count == 0)
+	{
+		return AnimationDetail::Full;
+	}
+
+	const Vec2 halfView = jngl::getScreenSize() / 2.0;
+	const Vec2 viewMin = (cameraPosition - halfView) / cameraZoom;
+	const Vec2 viewMax = (cameraPosition + halfView) / cameraZoom;
+	const Vec2 position = obj->getPosition();
+	if (position.x + obj->bounds->maxX < viewMin.x - ANIMATION_LOD_MARGIN ||
+		position.x + obj->bounds->minX > viewMax.x + ANIMATION_LOD_MARGIN ||
+		position.y + obj->bounds->maxY < viewMin.y - ANIMATION_LOD_MARGIN ||
+		position.y + obj->bounds->minY > viewMax.y + ANIMATION_LOD_MARGIN)
+	{
+		return AnimationDetail::EventsOnly;
+	}
+
+	if (ANIMATION_LOD_ZOOM > 0 && cameraZoom < ANIMATION_LOD_ZOOM)
+	{
+		return AnimationDetail::HalfRate;
+	}
+	if (ANIMATION_LOD_DISTANCE > 0)
+	{
+		const Vec2 distance = position - (viewMin + viewMax) / 2.0;
+		if (distance.x * distance.x + distance.y * distance.y > ANIMATION_LOD_DISTANCE * ANIMATION_LOD_DISTANCE)
+		{
+			return AnimationDetail::HalfRate;
+		}
+	}
+	return AnimationDetail::Full;
+}
+
 void Game::add(std::shared_ptr<SpineObject> obj) {
+	// Findable right away, scripts address new objects in the same step
+	objectsById[obj->getId()] = obj;
 	needToAdd.emplace_back(obj);
 }
 
 void Game::remove(std::shared_ptr<SpineObject> object) {
+	if (object)
+	{
+		auto indexed = objectsById.find(object->getId());
+		if (indexed != objectsById.end() && indexed->second.lock() == object)
+		{
+			objectsById.erase(indexed);
+		}
+	}
 	needToRemove.push_back(object);
 }
 
@@ -501,11 +798,37 @@ AudioManager *Game::getAudioManager()
 	return &audioManager;
 }
 
+JobSystem *Game::getJobSystem()
+{
+	return &jobSystem;
+}
+
+PathCache *Game::getPathCache()
+{
+	return &pathCache;
+}
+
+NavCrowd *Game::getNavCrowd()
+{
+	return &navCrowd;
+}
+
+LuaProfiler *Game::getLuaProfiler()
+{
+	return &luaProfiler;
+}
+
+ScriptScheduler *Game::getScriptScheduler()
+{
+	return &scriptScheduler;
+}
+
 void Game::runAction(std::string actionName, std::shared_ptr<SpineObject> thisObject)
 {
 	if (actionName == "")
         return;
 
+	LuaProfiler::Scope scope(luaProfiler, "action", actionName);
 	std::string errorMessage;
 	std::string script;
 	lua_state->set("this", thisObject);
@@ -533,14 +856,21 @@ void Game::runAction(std::string actionName, std::shared_ptr<SpineObject> thisOb
 		script = scriptstream.str();
 	}
 
-    auto result = lua_state->safe_script(script, sol::script_pass_on_error);
-
-	if (!result.valid()) {
-		sol::error err = result;
+	// Scripts run as coroutines, so that they can use the Wait functions
+	sol::load_result chunk = lua_state->load(script);
+	if (!chunk.valid()) {
+		sol::error err = chunk;
 		std::cerr << errorMessage
 		          << err.what()
 		          << std::endl;
+		return;
+	}
+	sol::protected_function action = chunk;
+	if (sceneEnvironment.valid())
+	{
+		sol::set_environment(sceneEnvironment, action);
 	}
+	scriptScheduler.run(*lua_state, action, sol::make_object(*lua_state, thisObject), errorMessage);
 }
 
 void Game::saveLuaState(std::string savefile)
@@ -559,6 +889,20 @@ void Game::loadLuaState(std::string savefile)
 	jngl::debugLn("Load all globals");
 	std::string state = jngl::readConfig(savefile);
 	auto result = lua_state->safe_script(state, sol::script_pass_on_error);
+	// Waiting scripts aren't part of the savegame
+	scriptScheduler.clear();
+	// The savegame replaced the state tables
+	for (auto &obj : gameObjects)
+	{
+		if (obj)
+		{
+			obj->resetLuaTable();
+		}
+	}
+	if (player)
+	{
+		player->resetLuaTable();
+	}
 
 	if (!result.valid())
 	{
@@ -585,6 +929,62 @@ void Game::loadLuaState(std::string savefile)
 	jngl::debugLn("Loaded all globals");
 }
 
+sol::table Game::getLuaTable(const std::string &objectId)
+{
+	if (objectId == "Player")
+	{
+		return (*lua_state)["player"];
+	}
+
+	std::string scene = (*lua_state)["game"]["scene"];
+	if (objectId == "Background")
+	{
+		return (*lua_state)["scenes"][scene]["background"];
+	}
+
+	sol::optional<sol::table> item = (*lua_state)["inventory_items"][objectId];
+	if (!item)
+	{
+		item = (*lua_state)["scenes"][scene]["items"][objectId];
+	}
+	return item ? *item : sol::table();
+}
+
+void Game::removeLuaTable(const std::string &objectId)
+{
+	sol::table inventory = (*lua_state)["inventory_items"];
+	if (inventory[objectId].valid())
+	{
+		inventory[objectId] = sol::lua_nil;
+		return;
+	}
+	std::string scene = (*lua_state)["game"]["scene"];
+	sol::optional<sol::table> items = (*lua_state)["scenes"][scene]["items"];
+	if (items)
+	{
+		(*items)[objectId] = sol::lua_nil;
+	}
+}
+
+void Game::moveToInventory(const std::shared_ptr<SpineObject> &obj, const std::string &skin)
+{
+	sol::table table = obj->getLuaTable();
+	if (!table.valid())
+	{
+		return;
+	}
+	table["skin"] = skin;
+	table["cross_scene"] = true;
+	(*lua_state)["inventory_items"][obj->getId()] = table;
+
+	std::string scene = (*lua_state)["game"]["scene"];
+	sol::optional<sol::table> items = (*lua_state)["scenes"][scene]["items"];
+	if (items)
+	{
+		(*items)[obj->getId()] = sol::lua_nil;
+	}
+}
+
 std::string Game::cleanLuaString(std::string variable)
 {
 	// The following strings denote other tokens:
@@ -669,7 +1069,7 @@ std::string Game::backupLuaTable(const sol::table table, const std::string &pare
 	return result;
 }
 
-std::shared_ptr<SpineObject> Game::getObjectById(std::string objectId)
+std::shared_ptr<SpineObject> Game::getObjectById(const std::string &objectId)
 {
 	if (objectId == "Player")
 	{
@@ -680,46 +1080,16 @@ std::shared_ptr<SpineObject> Game::getObjectById(std::string objectId)
 		return currentScene->background;
 	}
 
-	std::shared_ptr<SpineObject> obj = nullptr;
-	if ((*this->lua_state)[objectId].valid())
-	{
-		obj = (*this->lua_state)[objectId];
-	}
-	else if ((*this->lua_state)["inventory_items"][objectId].valid())
+	auto indexed = objectsById.find(objectId);
+	if (indexed == objectsById.end())
 	{
-		obj = (*this->lua_state)["inventory_items"][objectId]["object"];
+		return nullptr;
 	}
-	else
+	auto obj = indexed->second.lock();
+	if (!obj || obj->isDeleted())
 	{
-		std::string scene = (*this->lua_state)["game"]["scene"];
-		if ((*this->lua_state)["scenes"][scene]["items"][objectId].valid())
-		{
-			obj = (*this->lua_state)["scenes"][scene]["items"][objectId]["object"];
-		}
+		return nullptr;
 	}
 	return obj;
 }
 
-std::string Game::getLUAPath(std::string objectId)
-{
-	if (objectId == "Player")
-	{
-		return "player";
-	}
-
-	std::string scene = (*this->lua_state)["game"]["scene"];
-	if (objectId == "Background")
-	{
-		return "scenes[\"" + scene + "\"][\"background\"]";
-	}
-
-	if ((*this->lua_state)["inventory_items"][objectId].valid())
-	{
-		return "inventory_items[\"" + objectId + "\"]";
-	}
-	else if ((*this->lua_state)["scenes"][scene]["items"][objectId].valid())
-	{
-		return "scenes[\"" + scene + "\"][\"items\"][\"" + objectId + "\"]";
-	}
-	return "";
-}
@@ -2,6 +2,7 @@
 
 #include <jngl.hpp>
 #include <set>
+#include <unordered_map>
 #include <vector>
 #include <sol/sol.hpp>
 #if (!defined(NDEBUG) && !defined(ANDROID) && !defined(EMSCRIPTEN))
@@ -12,6 +13,11 @@
 #include "scene.hpp"
 #include "dialog/dialog_manager.hpp"
 #include "audio_manager.hpp"
+#include "job_system.hpp"
+#include "path_cache.hpp"
+#include "nav_agent.hpp"
+#include "script_scheduler.hpp"
+#include "lua_profiler.hpp"
 
 class Game : public jngl::Work, public std::enable_shared_from_this<Game>
 {
@@ -31,6 +37,8 @@ public:
 
 #ifndef NDEBUG
     void debugStep();
+    /// Statistics shown on top of the scene while the debug draw is enabled
+    void drawDebugOverlay() const;
     bool editMode = false;
     bool enableDebugDraw = false;
 #endif
@@ -47,7 +55,19 @@ public:
     void setCameraPositionImmediately(jngl::Vec2);
 
     void stepCamera();
+    /// Runs the Lua garbage collector until LUA_GC_BUDGET, or LUA_GC_OVERDUE_BUDGET if the heap grew too much, is used up
+    void stepLuaGarbageCollector();
+    /// Updates all Spine animations in parallel and replays their events afterwards
+    void stepAnimations();
+    /// Picks how detailed an object's animation has to be updated this step
+    AnimationDetail getAnimationDetail(const std::shared_ptr<SpineObject> &obj) const;
+    /// Rebuilds the navmesh of the current background
     void triangulateBorder();
+    /// Globals the scripts of the current scene create. Dropped when another scene is loaded,
+    /// unless they are marked with Persist. Invalid before the first scene is loaded.
+    const sol::environment &getSceneEnvironment() const { return sceneEnvironment; }
+    /// Moves a variable of the scene's scripts to the globals, so that it survives scene loads
+    void persist(const std::string &name);
 
     void add(std::shared_ptr<SpineObject> obj);
     void remove(std::shared_ptr<SpineObject> obj);
@@ -58,6 +78,11 @@ public:
 
     std::shared_ptr<DialogManager> getDialogManager();
     AudioManager* getAudioManager();
+    JobSystem* getJobSystem();
+    PathCache* getPathCache();
+    NavCrowd* getNavCrowd();
+    LuaProfiler* getLuaProfiler();
+    ScriptScheduler* getScriptScheduler();
     void addObjects();
     void removeObjects();
 
@@ -72,8 +97,16 @@ public:
     };
     int getInactivLayerBorder() { return inactivLayerBorder; };
 
-    std::shared_ptr<SpineObject> getObjectById(std::string objectId);
-    std::string getLUAPath(std::string objectId);
+    /// Object with the id from the index maintained by add, remove and loadLevel.
+    /// Objects that are deleted but not removed yet aren't found.
+    std::shared_ptr<SpineObject> getObjectById(const std::string &objectId);
+    /// State table of an object: player, scenes[scene].background, inventory_items[id] or
+    /// scenes[scene].items[id]. Invalid if there is none.
+    sol::table getLuaTable(const std::string &objectId);
+    /// Removes the table of an item from the scene or the inventory
+    void removeLuaTable(const std::string &objectId);
+    /// Moves the table of an item from the scene to inventory_items
+    void moveToInventory(const std::shared_ptr<SpineObject> &obj, const std::string &skin);
 
     std::string cleanLuaString(std::string variable);
     YAML::Node config;
@@ -81,6 +114,10 @@ public:
 private:
 	std::vector<std::shared_ptr<SpineObject>> needToAdd;
 	std::vector<std::shared_ptr<SpineObject>> needToRemove;
+	/// Index for getObjectById, without the player and the background
+	std::unordered_map<std::string, std::weak_ptr<SpineObject>> objectsById;
+	/// Lua objects returned by GetObject by ID, with weak values
+	sol::table objectHandles;
     std::string backupLuaTable(const sol::table table, const std::string &parent);
     jngl::Vec2 cameraPosition;
     jngl::Vec2 targetCameraPosition;
@@ -89,6 +126,42 @@ private:
     int inactivLayerBorder = 0;
     std::shared_ptr<DialogManager> dialogManager = nullptr;
     AudioManager audioManager;
+    size_t stepAllocations = 0;
+    mutable size_t drawAllocations = 0;
+    struct AnimationUpdate
+    {
+        SpineObject *object;
+        AnimationDetail detail;
+    };
+    /// Objects taking part in the current animation update, reused every step
+    std::vector<AnimationUpdate> animationUpdates;
+    /// Extra space around the view in which objects still count as visible
+    const double ANIMATION_LOD_MARGIN;
+    /// Objects further away from the view's center run at half rate, 0 disables it
+    const double ANIMATION_LOD_DISTANCE;
+    /// Below this camera zoom all objects except the player run at half rate, 0 disables it
+    const double ANIMATION_LOD_ZOOM;
+    /// Microseconds per step for incremental Lua garbage collection, 0 leaves it to Lua
+    const double LUA_GC_BUDGET;
+    /// Budget while the heap grew to twice its size after the last cycle, still a fixed limit per step
+    const double LUA_GC_OVERDUE_BUDGET;
+    /// Time of the last collection step and heap size after the last finished cycle
+    double luaGcSeconds = 0;
+    size_t luaHeapAfterCycle = 0;
+    /// Replaces the environment of the previous scene with an empty one
+    void createSceneEnvironment();
+    sol::environment sceneEnvironment;
+    /// Shared by all scene environments: reads fall back to the globals, writes to existing
+    /// or persisted globals go there
+    sol::table sceneEnvironmentMetatable;
+#ifndef NDEBUG
+    /// Names of the variables of left scenes and the scene, reading one of them logs a warning
+    sol::table droppedSceneVariables;
+#endif
+    PathCache pathCache;
+    NavCrowd navCrowd;
+    ScriptScheduler scriptScheduler;
+    LuaProfiler luaProfiler;
 
 #if (!defined(NDEBUG) && !defined(ANDROID) && !defined(EMSCRIPTEN))
     std::shared_ptr<GifAnim> gifAnimation;
@@ -101,4 +174,7 @@ private:
     const int GIF_FRAME_SKIP = 10;
     const int GIF_DOWNSCALE_FACTOR = 2;
 #endif
+    /// Declared last so that it's destroyed first: its destructor runs the remaining path
+    /// requests and continuations, which use the path cache and the objects
+    JobSystem jobSystem;
 };
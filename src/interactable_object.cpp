@@ -6,7 +6,9 @@
 #include <cmath>
 
 InteractableObject::InteractableObject(std::shared_ptr<Game> game, const std::string &spine_file, const std::string id, float scale) :
-    SpineObject(game, spine_file, id, scale)
+    SpineObject(game, spine_file, id, scale),
+    AGENT_MAX_SPEED(game->config["agent_max_speed"].as<float>(4.0f)),
+    AGENT_RADIUS(game->config["agent_radius"].as<float>(30.0f))
 #ifndef NDEBUG
     ,DEBUG_GRAP_DISTANCE(game->config["debug_grap_distance"].as<float>())
 #endif
@@ -23,10 +25,6 @@ bool InteractableObject::step(bool force)
 {
     if (auto _game = game.lock())
     {
-        skeleton->step();
-        spSkeleton_updateWorldTransform(skeleton->skeleton);
-        spSkeletonBounds_update(bounds, skeleton->skeleton, true);
-
 #ifndef NDEBUG
         if (_game->editMode && jngl::mousePressed())
         {
@@ -95,8 +93,8 @@ void InteractableObject::registerToDelete()
 
     if (auto _game = game.lock())
     {
-        auto lua_object = _game->getLUAPath(luaIndex);
-        _game->lua_state->script(lua_object + " = nil");
+        _game->removeLuaTable(luaIndex);
+        resetLuaTable();
     }
 }
 
@@ -156,3 +154,33 @@ void InteractableObject::goToPosition(jngl::Vec2 position, sol::function callbac
         _game->player->addTargetPositionImmediately(this->position + position, callback);
     }
 }
+
+void InteractableObject::walkTo(jngl::Vec2 target, sol::function callback)
+{
+    if (auto _game = game.lock())
+    {
+        if (!navAgent)
+        {
+            navAgent = std::make_shared<NavAgent>(getptr(), AGENT_MAX_SPEED, AGENT_RADIUS);
+            _game->getNavCrowd()->add(navAgent);
+        }
+        std::weak_ptr<SpineObject> self = getptr();
+        navAgent->walkTo(target, [self, callback]()
+                         {
+                             if (auto obj = self.lock())
+                             {
+                                 obj->savePosition();
+                                 callback();
+                             }
+                         });
+    }
+}
+
+void InteractableObject::stopWalking()
+{
+    if (navAgent && navAgent->isWalking())
+    {
+        navAgent->stop();
+        savePosition();
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "spine_object.hpp"
+#include "nav_agent.hpp"
 
 #include <array>
 #include <jngl.hpp>
@@ -17,11 +18,19 @@ public:
     void draw() const override;
 
     void goToPosition(jngl::Vec2 position, sol::function callback);
+    /// Lets the object itself walk over the navmesh to target, callback is called on arrival
+    void walkTo(jngl::Vec2 target, sol::function callback);
+    void stopWalking();
+    bool isWalking() const override { return navAgent && navAgent->isWalking(); }
 
     void registerToDelete();
     void setLuaIndex(const std::string &index){luaIndex = index;};
 private:
     std::string luaIndex = "";
+    const float AGENT_MAX_SPEED;
+    const float AGENT_RADIUS;
+    /// Created on the first walk
+    std::shared_ptr<NavAgent> navAgent;
 #ifndef NDEBUG
     const float DEBUG_GRAP_DISTANCE;
     jngl::Vec2 dragposition = jngl::Vec2(0,0);
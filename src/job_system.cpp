@@ -0,0 +1,267 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+namespace
+{
+    /// Pool and index of the worker running on this thread
+    thread_local const JobSystem *currentPool = nullptr;
+    thread_local size_t currentWorker = SIZE_MAX;
+} // namespace
+
+TaskGroup::TaskGroup(JobSystem &jobSystem) : jobSystem(jobSystem)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    while (pending.load() > 0)
+    {
+        if (!jobSystem.runPendingJob(jobSystem.currentWorkerIndex()))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskGroup::run(std::function<void()> job)
+{
+    pending.fetch_add(1);
+    jobSystem.push([this, job = std::move(job)]()
+                   {
+                       try
+                       {
+                           job();
+                       }
+                       catch (...)
+                       {
+                           std::lock_guard<std::mutex> lock(exceptionMutex);
+                           if (!exception)
+                           {
+                               exception = std::current_exception();
+                           }
+                       }
+                       // Last access to this group, the waiting thread may destroy it afterwards
+                       pending.fetch_sub(1);
+                   });
+}
+
+void TaskGroup::wait()
+{
+    // Help out instead of waiting idle
+    while (pending.load() > 0)
+    {
+        if (!jobSystem.runPendingJob(jobSystem.currentWorkerIndex()))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    std::exception_ptr rethrow;
+    {
+        std::lock_guard<std::mutex> lock(exceptionMutex);
+        std::swap(rethrow, exception);
+    }
+    if (rethrow)
+    {
+        std::rethrow_exception(rethrow);
+    }
+}
+
+JobSystem::JobSystem(size_t workerCount)
+{
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        queues.emplace_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    // The workers only stop once every queued job ran
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    // Continuations of submitThen, also the ones queued by other continuations
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mainThreadMutex);
+            if (mainThreadJobs.empty())
+            {
+                break;
+            }
+        }
+        try
+        {
+            runMainThreadJobs();
+        }
+        catch (...)
+        {
+            // Nobody is left to handle it, the remaining continuations still run
+        }
+    }
+}
+
+size_t JobSystem::defaultWorkerCount()
+{
+#if defined(EMSCRIPTEN) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 0;
+#else
+    const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+#endif
+}
+
+size_t JobSystem::currentWorkerIndex() const
+{
+    return currentPool == this ? currentWorker : SIZE_MAX;
+}
+
+void JobSystem::push(Job job)
+{
+    if (queues.empty())
+    {
+        job();
+        return;
+    }
+
+    // Workers push to their own queue, all other threads distribute round robin
+    size_t index = currentWorkerIndex();
+    if (index >= queues.size())
+    {
+        index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->jobs.emplace_back(std::move(job));
+    }
+    pendingJobs.fetch_add(1);
+    {
+        // Empty lock so that a worker between checking pendingJobs and waiting can't miss the notify
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+bool JobSystem::runPendingJob(size_t index)
+{
+    Job job;
+    if (index < queues.size())
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        if (!queues[index]->jobs.empty())
+        {
+            job = std::move(queues[index]->jobs.back());
+            queues[index]->jobs.pop_back();
+        }
+    }
+    const size_t start = index < queues.size() ? index + 1 : 0;
+    for (size_t i = 0; !job && i < queues.size(); ++i)
+    {
+        auto &victim = *queues[(start + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+        }
+    }
+    if (!job)
+    {
+        return false;
+    }
+    pendingJobs.fetch_sub(1);
+    job();
+    return true;
+}
+
+void JobSystem::workerLoop(size_t index)
+{
+    currentPool = this;
+    currentWorker = index;
+    while (true)
+    {
+        if (runPendingJob(index))
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]() { return stopping || pendingJobs.load() > 0; });
+        if (stopping && pendingJobs.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+void JobSystem::parallelFor(size_t count, const std::function<void(size_t)> &func, size_t grainSize)
+{
+    grainSize = std::max<size_t>(grainSize, 1);
+    if (queues.empty() || count <= grainSize)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    TaskGroup group(*this);
+    for (size_t begin = 0; begin < count; begin += grainSize)
+    {
+        group.run([&func, begin, end = std::min(count, begin + grainSize)]()
+                  {
+                      for (size_t i = begin; i < end; ++i)
+                      {
+                          func(i);
+                      }
+                  });
+    }
+    group.wait();
+}
+
+void JobSystem::runOnMainThread(std::function<void()> func)
+{
+    std::lock_guard<std::mutex> lock(mainThreadMutex);
+    mainThreadJobs.emplace_back(std::move(func));
+}
+
+void JobSystem::runMainThreadJobs()
+{
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        std::swap(mainThreadJobs, runningMainThreadJobs);
+    }
+    size_t next = 0;
+    try
+    {
+        while (next < runningMainThreadJobs.size())
+        {
+            runningMainThreadJobs[next++]();
+        }
+    }
+    catch (...)
+    {
+        // The failed function counts as done, the ones after it run first on the next call
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        mainThreadJobs.insert(mainThreadJobs.begin(), std::make_move_iterator(runningMainThreadJobs.begin() + next),
+                              std::make_move_iterator(runningMainThreadJobs.end()));
+        runningMainThreadJobs.clear();
+        throw;
+    }
+    runningMainThreadJobs.clear();
+}
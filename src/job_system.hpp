@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class JobSystem;
+
+/// A set of jobs that can be waited for together.
+/// The first exception thrown by one of the jobs is rethrown by wait().
+class TaskGroup
+{
+public:
+    explicit TaskGroup(JobSystem &jobSystem);
+    /// Waits for all jobs, they reference this group
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    void run(std::function<void()> job);
+    /// Executes pending jobs on the calling thread until all jobs of this group are done
+    void wait();
+
+private:
+    JobSystem &jobSystem;
+    std::atomic<size_t> pending{0};
+    std::mutex exceptionMutex;
+    std::exception_ptr exception;
+};
+
+/// Small work-stealing thread pool.
+/// Every worker owns a queue it takes jobs from (LIFO). Idle workers steal the oldest jobs
+/// from the other queues. A thread waiting for jobs helps executing them instead of blocking.
+class JobSystem
+{
+public:
+    /// workerCount == 0 runs every job directly on the calling thread.
+    explicit JobSystem(size_t workerCount = defaultWorkerCount());
+    /// Nothing queued is dropped: the workers finish all jobs, including the ones queued by jobs,
+    /// then the functions queued by runOnMainThread and the continuations of submitThen run on
+    /// the destroying thread. Exceptions they throw are ignored. Destroy the pool on the main
+    /// thread while everything the continuations use is still alive.
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    /// Calls func(i) for every i in [0, count) and returns after all calls are done.
+    /// Indices are grouped into jobs of grainSize elements.
+    void parallelFor(size_t count, const std::function<void(size_t)> &func, size_t grainSize = 1);
+
+    /// Runs func on a worker, the result or exception is passed through the future.
+    template <class Func>
+    std::future<std::invoke_result_t<Func>> submit(Func func)
+    {
+        using Result = std::invoke_result_t<Func>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+        auto future = task->get_future();
+        push([task]() { (*task)(); });
+        return future;
+    }
+
+    /// Runs work on a worker and afterwards continuation(error, result) on the main thread, or
+    /// continuation(error) if work returns void. error is set if work threw, result is value
+    /// initialized then. Use this for everything that needs Lua or the scene graph after the heavy lifting.
+    template <class Func, class Continuation>
+    void submitThen(Func work, Continuation continuation)
+    {
+        using Result = std::invoke_result_t<Func>;
+        push([this, work = std::move(work), continuation = std::move(continuation)]() mutable
+             {
+                 std::exception_ptr error;
+                 if constexpr (std::is_void_v<Result>)
+                 {
+                     try
+                     {
+                         work();
+                     }
+                     catch (...)
+                     {
+                         error = std::current_exception();
+                     }
+                     runOnMainThread([continuation = std::move(continuation), error]() mutable
+                                     { continuation(error); });
+                 }
+                 else
+                 {
+                     auto result = std::make_shared<Result>();
+                     try
+                     {
+                         *result = work();
+                     }
+                     catch (...)
+                     {
+                         error = std::current_exception();
+                     }
+                     runOnMainThread([continuation = std::move(continuation), error, result]() mutable
+                                     { continuation(error, std::move(*result)); });
+                 }
+             });
+    }
+
+    /// Like future.get(), but executes pending jobs while waiting.
+    template <class T>
+    T wait(std::future<T> &future)
+    {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            if (!runPendingJob(currentWorkerIndex()))
+            {
+                std::this_thread::yield();
+            }
+        }
+        return future.get();
+    }
+
+    /// Queues func to be called by runMainThreadJobs. Can be called from any thread.
+    void runOnMainThread(std::function<void()> func);
+    /// Calls all functions queued by runOnMainThread in the order they were queued.
+    /// Called once per step by Game. If one throws, the exception is passed on and the functions
+    /// after it stay queued for the next call.
+    void runMainThreadJobs();
+
+    size_t getWorkerCount() const { return threads.size(); }
+
+    /// One worker per hardware thread, the main thread being the remaining one.
+    static size_t defaultWorkerCount();
+
+private:
+    friend class TaskGroup;
+    using Job = std::function<void()>;
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void push(Job job);
+    /// Runs one job from the queue of worker `index` or steals one from the others.
+    /// Returns false if no job was found.
+    bool runPendingJob(size_t index);
+    /// Index of the worker of this pool running on the calling thread, SIZE_MAX for other threads
+    size_t currentWorkerIndex() const;
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<size_t> pendingJobs{0};
+    std::atomic<size_t> nextQueue{0};
+    bool stopping = false;
+
+    std::mutex mainThreadMutex;
+    std::vector<std::function<void()>> mainThreadJobs;
+    /// Swapped with mainThreadJobs, so that queued functions can queue new ones
+    std::vector<std::function<void()>> runningMainThreadJobs;
+};
@@ -23,6 +23,188 @@ std::optional<jngl::Vec2> getPointPosition(std::shared_ptr<Game> game, const std
 
 void Game::setupLuaFunctions()
 {
+	/// Spine objects can be used directly. Keep the object in a local variable instead of passing
+	/// its ID to the ...On functions every time:
+	///
+	///local banana = GetObject("banana")
+	///banana:playAnimation(0, "jump", false, pass)
+	///banana.visible = false
+	///banana.position = {x = 100, y = 20}
+	///local x, y = banana:getPosition()
+	lua_state->new_usertype<SpineObject>("SpineObject",
+		sol::no_constructor,
+		"id", sol::readonly_property(&SpineObject::getId),
+		"name", sol::readonly_property(&SpineObject::getName),
+		"position", sol::property(
+			[](SpineObject &obj, sol::this_state state)
+			{
+				const auto position = obj.getPosition();
+				return sol::state_view(state).create_table_with("x", position.x, "y", position.y);
+			},
+			[](SpineObject &obj, sol::table position)
+			{
+				obj.setPosition(jngl::Vec2(position.get<double>("x"), position.get<double>("y")));
+				obj.savePosition();
+			}),
+		// Like position, but returns x and y instead of a new table
+		"getPosition", [](SpineObject &obj)
+		{
+			const auto position = obj.getPosition();
+			return std::tuple(position.x, position.y);
+		},
+		"visible", sol::property(
+			&SpineObject::getVisible,
+			[](SpineObject &obj, bool visible)
+			{
+				obj.setVisible(visible);
+				obj.setLuaField("visible", visible);
+			}),
+		"layer", sol::property(
+			[](SpineObject &obj) { return obj.layer; },
+			[](SpineObject &obj, int layer)
+			{
+				obj.layer = layer;
+				obj.setLuaField("layer", layer);
+			}),
+		"rotation", sol::property(&SpineObject::getRotation, &SpineObject::setRotation),
+		"playAnimation", [](SpineObject &obj, int trackIndex, const std::string &animation, bool loop, sol::function callback)
+		{
+			obj.playAnimation(trackIndex, animation, loop, callback);
+			obj.saveAnimation(animation, loop);
+		},
+		"addAnimation", [](SpineObject &obj, int trackIndex, const std::string &animation, bool loop, float delay, sol::function callback)
+		{
+			obj.addAnimation(trackIndex, animation, loop, delay, callback);
+			obj.saveAnimation(animation, loop);
+		},
+		"setSkin", [](SpineObject &obj, const std::string &skin)
+		{
+			obj.setSkin(skin);
+			obj.setLuaField("skin", skin);
+		},
+		"getPoint", [](SpineObject &obj, const std::string &pointName) -> sol::optional<std::tuple<double, double>>
+		{
+			auto position = obj.getPoint(pointName);
+			if (!position)
+			{
+				return sol::nullopt;
+			}
+			return std::tuple(position->x, position->y);
+		},
+		"getPointNames", [](SpineObject &obj) { return sol::as_table(obj.getPointNames()); },
+		"walkTo", [](SpineObject &obj, double x, double y, sol::function callback)
+		{
+			auto item = dynamic_cast<InteractableObject *>(&obj);
+			if (!item)
+			{
+				throw std::runtime_error("walkTo needs an object that can walk, " + obj.getId() + " can't");
+			}
+			item->walkTo(jngl::Vec2(x, y), callback);
+		},
+		"delete", [](SpineObject &obj)
+		{
+			auto item = dynamic_cast<InteractableObject *>(&obj);
+			if (!item)
+			{
+				throw std::runtime_error("Only items can be deleted, " + obj.getId() + " can't");
+			}
+			item->registerToDelete();
+		});
+
+	// Handles of GetObject, weak so that they don't keep the objects alive
+	objectHandles = lua_state->create_table();
+	objectHandles[sol::metatable_key] = lua_state->create_table_with("__mode", "v");
+
+	/// Pauses the script for some steps. The Wait functions only work in the scripts of an action,
+	/// not in callbacks.
+	///
+	///PlayAnimation(0, "open", false, pass)
+	///WaitForAnimation()
+	///GoToPoint("door", pass)
+	///WaitForWalk()
+	///WaitFrames(30)
+	///LoadScene("corridor")
+	/// int frames: Number of steps to wait
+	lua_state->set_function("WaitFrames",
+							sol::yielding([this](int frames, sol::this_state state)
+										  {
+											  if (!scriptScheduler.wait(state, frames, nullptr))
+											  {
+												  throw std::runtime_error("WaitFrames can't be used in a callback");
+											  }
+										  }));
+
+	/// Pauses the script until the player or an object stops walking
+	/// string object: Objects ID, the player if omitted
+	lua_state->set_function("WaitForWalk",
+							sol::yielding([this](sol::optional<std::string> object, sol::this_state state)
+										  {
+											  std::weak_ptr<SpineObject> obj = object ? getObjectById(*object) : std::static_pointer_cast<SpineObject>(player);
+											  auto walked = [obj]()
+											  {
+												  auto current = obj.lock();
+												  return !current || !current->isWalking();
+											  };
+											  if (!scriptScheduler.wait(state, 0, walked))
+											  {
+												  throw std::runtime_error("WaitForWalk can't be used in a callback");
+											  }
+										  }));
+
+	/// Pauses the script until the current animation of an object ends. Looped animations end
+	/// with their current loop.
+	/// string object: Objects ID, the calling object if omitted
+	/// int trackIndex: Spines animation track [default: 0]
+	lua_state->set_function("WaitForAnimation",
+							sol::yielding([this](sol::optional<std::string> object, sol::optional<int> trackIndex, sol::this_state state)
+										  {
+											  std::shared_ptr<SpineObject> obj = object ? getObjectById(*object) : (*lua_state)["this"];
+											  if (!obj)
+											  {
+												  throw std::runtime_error("No object " + object.value_or("this"));
+											  }
+											  if (!scriptScheduler.wait(state, 0, obj->animationEnded(trackIndex.value_or(0))))
+											  {
+												  throw std::runtime_error("WaitForAnimation can't be used in a callback");
+											  }
+										  }));
+
+	/// Get an object to use it directly, see SpineObject. As long as a script keeps the object,
+	/// GetObject returns the same one again.
+	/// string object: Objects ID, "Player" and "Background" work as well
+	/// returns: the object or nil
+	lua_state->set_function("GetObject",
+							[this](const std::string &object, sol::this_state state) -> sol::object
+							{
+								auto obj = getObjectById(object);
+								if (!obj)
+								{
+									return sol::lua_nil;
+								}
+								sol::object handle = objectHandles[object];
+								// The ID can belong to a new object after a scene was loaded again
+								if (handle.is<SpineObject>() && &handle.as<SpineObject &>() == obj.get())
+								{
+									return handle;
+								}
+								handle = sol::make_object(state, std::move(obj));
+								objectHandles[object] = handle;
+								return handle;
+							});
+
+	/// Variables the scripts of a scene create are dropped when another scene is loaded.
+	/// Persist keeps a variable across scenes and in the savegame, like the variables that
+	/// existed before the scene was loaded.
+	///
+	///has_key = true
+	///Persist("has_key")
+	/// string name: Name of the variable
+	lua_state->set_function("Persist",
+							[this](const std::string &name)
+							{
+								persist(name);
+							});
+
 	/// pass is a function doing nothing
 	/// You can use it for testing or for not needed callbacks
 	lua_state->set_function("pass",
@@ -68,16 +250,7 @@ void Game::setupLuaFunctions()
 							{
 								std::shared_ptr<SpineObject> obj = (*lua_state)["this"];
 								obj->playAnimation(trackIndex, newAnimation, loop, callback);
-								std::string lua_object = getLUAPath(obj->getId());
-								lua_state->script(lua_object + ".animation = \"" + newAnimation + "\"");
-								if (loop)
-								{
-									lua_state->script(lua_object + ".loop_animation = true");
-								}
-								else
-								{
-									lua_state->script(lua_object + ".loop_animation = false");
-								}
+								obj->saveAnimation(newAnimation, loop);
 							});
 
 	/// Adds an animation on the calling Spine object that will be played after the current animation ends
@@ -90,16 +263,7 @@ void Game::setupLuaFunctions()
 							{
 								std::shared_ptr<SpineObject> obj = (*lua_state)["this"];
 								obj->addAnimation(trackIndex, newAnimation, loop, delay, callback);
-								std::string lua_object = getLUAPath(obj->getId());
-								lua_state->script(lua_object + ".animation = \"" + newAnimation + "\"");
-								if (loop)
-								{
-									lua_state->script(lua_object + ".loop_animation = true");
-								}
-								else
-								{
-									lua_state->script(lua_object + ".loop_animation = false");
-								}
+								obj->saveAnimation(newAnimation, loop);
 							});
 
 	/// See PlayAnimation
@@ -111,16 +275,7 @@ void Game::setupLuaFunctions()
 								if (obj)
 								{
 									obj->playAnimation(trackIndex, newAnimation, loop, callback);
-									std::string lua_object = getLUAPath(obj->getId());
-									lua_state->script(lua_object + ".animation = \"" + newAnimation + "\"");
-									if (loop)
-									{
-										lua_state->script(lua_object + ".loop_animation = true");
-									}
-									else
-									{
-										lua_state->script(lua_object + ".loop_animation = false");
-									}
+									obj->saveAnimation(newAnimation, loop);
 								}
 							});
 
@@ -133,16 +288,7 @@ void Game::setupLuaFunctions()
 								if (obj)
 								{
 									obj->addAnimation(trackIndex, newAnimation, loop, delay, callback);
-									std::string lua_object = getLUAPath(obj->getId());
-									lua_state->script(lua_object + ".animation = \"" + newAnimation + "\"");
-									if (loop)
-									{
-										lua_state->script(lua_object + ".loop_animation = true");
-									}
-									else
-									{
-										lua_state->script(lua_object + ".loop_animation = false");
-									}
+									obj->saveAnimation(newAnimation, loop);
 								}
 							});
 
@@ -154,8 +300,7 @@ void Game::setupLuaFunctions()
 								std::shared_ptr<SpineObject> obj = (*lua_state)["this"];
 								jngl::debugLn("setting skin of " + obj->getName() + " to " + skin);
 								obj->setSkin(skin);
-								std::string lua_object = getLUAPath(obj->getId());
-								lua_state->script(lua_object + ".skin = \"" + skin + "\"");
+								obj->setLuaField("skin", skin);
 							});
 
 	/// See SetSkin
@@ -167,8 +312,7 @@ void Game::setupLuaFunctions()
 								if (obj)
 								{
 									obj->setSkin(skin);
-									std::string lua_object = getLUAPath(object);
-									lua_state->script(lua_object + ".skin = \"" + skin + "\"");
+									obj->setLuaField("skin", skin);
 								}
 							});
 
@@ -200,11 +344,7 @@ void Game::setupLuaFunctions()
 								obj->setSkin(config["inventar_default_skin"].as<std::string>());
 								obj->cross_scene = true;
 								obj->setVisible(false);
-								lua_state->script("inventory_items[\"" + obj->getId() + "\"] = scenes[game.scene].items." + obj->getId());
-								lua_state->script("inventory_items[\"" + obj->getId() + "\"].skin = \"" + config["inventar_default_skin"].as<std::string>() + "\"");
-								lua_state->script("inventory_items[\"" + obj->getId() + "\"].cross_scene = true");
-
-								lua_state->script("scenes[game.scene].items." + obj->getId() + " = nil");
+								moveToInventory(obj, config["inventar_default_skin"].as<std::string>());
 							});
 
 	/// See AddToInventory
@@ -216,11 +356,7 @@ void Game::setupLuaFunctions()
 								obj->setSkin(skin);
 								obj->cross_scene = true;
 								obj->setVisible(false);
-								lua_state->script("inventory_items[\"" + obj->getId() + "\"] = scenes[game.scene].items." + obj->getId());
-								lua_state->script("inventory_items[\"" + obj->getId() + "\"].skin = \"" + skin + "\"");
-								lua_state->script("inventory_items[\"" + obj->getId() + "\"].cross_scene = true");
-
-								lua_state->script("scenes[game.scene].items." + obj->getId() + " = nil");
+								moveToInventory(obj, skin);
 							});
 
 	/// See AddToInventory
@@ -235,11 +371,7 @@ void Game::setupLuaFunctions()
 									obj->setSkin(config["inventar_default_skin"].as<std::string>());
 									obj->cross_scene = true;
 									obj->setVisible(false);
-									lua_state->script("inventory_items[\"" + object + "\"] = scenes[game.scene].items." + object);
-									lua_state->script("inventory_items[\"" + object + "\"].skin = \"" + config["inventar_default_skin"].as<std::string>() + "\"");
-									lua_state->script("inventory_items[\"" + object + "\"].cross_scene = true");
-
-									lua_state->script("scenes[game.scene].items." + object + " = nil");
+									moveToInventory(obj, config["inventar_default_skin"].as<std::string>());
 								}
 							});
 
@@ -256,11 +388,7 @@ void Game::setupLuaFunctions()
 									obj->setSkin(config[skin].as<std::string>());
 									obj->cross_scene = true;
 									obj->setVisible(false);
-									lua_state->script("inventory_items[\"" + object + "\"] = scenes[game.scene].items." + object);
-									lua_state->script("inventory_items[\"" + object + "\"].skin = \"" + skin + "\"");
-									lua_state->script("inventory_items[\"" + object + "\"].cross_scene = true");
-
-									lua_state->script("scenes[game.scene].items." + object + " = nil");
+									moveToInventory(obj, skin);
 								}
 							});
 
@@ -269,7 +397,7 @@ void Game::setupLuaFunctions()
 							[this]()
 							{
 								std::shared_ptr<SpineObject> obj = (*lua_state)["this"];
-								lua_state->script("inventory_items[\"" + obj->getId() + "\"] = nil");
+								(*lua_state)["inventory_items"][obj->getId()] = sol::lua_nil;
 								obj->cross_scene = false;
 							});
 
@@ -280,7 +408,7 @@ void Game::setupLuaFunctions()
 								std::shared_ptr<SpineObject> obj = getObjectById(object);
 								if (obj)
 								{
-									lua_state->script("inventory_items[\"" + object + "\"] = nil");
+									(*lua_state)["inventory_items"][object] = sol::lua_nil;
 									obj->cross_scene = false;
 								}
 							});
@@ -366,6 +494,46 @@ void Game::setupLuaFunctions()
 								}
 							});
 
+	/// Let this object walk over the walkable area of the scene.
+	/// Many objects can walk at the same time, they keep some distance to each other.
+	/// float x, float y: Target position in the scene
+	/// function callback: Function that will be called when the object reaches the position
+	lua_state->set_function("WalkTo",
+							[this](double x, double y, sol::function callback)
+							{
+								auto obj = std::dynamic_pointer_cast<InteractableObject>((*lua_state)["this"].get<std::shared_ptr<SpineObject>>());
+								if (!obj)
+								{
+									throw std::runtime_error("WalkTo needs this to be an object that can walk");
+								}
+								obj->walkTo(jngl::Vec2(x, y), callback);
+							});
+
+	/// See WalkTo
+	/// string object: Objects ID that should be effected
+	lua_state->set_function("WalkToOn",
+							[this](const std::string &object, double x, double y, sol::function callback)
+							{
+								auto obj = std::dynamic_pointer_cast<InteractableObject>(getObjectById(object));
+								if (!obj)
+								{
+									throw std::runtime_error("No object " + object);
+								}
+								obj->walkTo(jngl::Vec2(x, y), callback);
+							});
+
+	/// Stop an object walking because of WalkTo, its callback won't be called
+	/// string object: Objects ID that should be effected
+	lua_state->set_function("StopWalkingOn",
+							[this](const std::string &object)
+							{
+								auto obj = std::dynamic_pointer_cast<InteractableObject>(getObjectById(object));
+								if (obj)
+								{
+									obj->stopWalking();
+								}
+							});
+
 	/// Stop player in position
 	lua_state->set_function("StopWalking",
 							[this]()
@@ -397,9 +565,7 @@ void Game::setupLuaFunctions()
 								if (position)
 								{
 									obj->setPosition(position.value());
-									std::string lua_object = getLUAPath(obj->getId());
-									lua_state->script(lua_object + ".x = \"" + std::to_string(position->x) + "\"");
-									lua_state->script(lua_object + ".y = \"" + std::to_string(position->y) + "\"");
+									obj->savePosition();
 								}
 							});
 
@@ -416,9 +582,7 @@ void Game::setupLuaFunctions()
 									if (position)
 									{
 										obj->setPosition(position.value());
-										std::string lua_object = getLUAPath(object);
-										lua_state->script(lua_object + ".x = \"" + std::to_string(position->x) + "\"");
-										lua_state->script(lua_object + ".y = \"" + std::to_string(position->y) + "\"");
+										obj->savePosition();
 									}
 								}
 							});
@@ -442,9 +606,7 @@ void Game::setupLuaFunctions()
 									if (obj && position)
 									{
 										obj->setPosition(position.value());
-										std::string lua_object = getLUAPath(object);
-										lua_state->script(lua_object + ".x = \"" + std::to_string(position->x) + "\"");
-										lua_state->script(lua_object + ".y = \"" + std::to_string(position->y) + "\"");
+										obj->savePosition();
 									}
 								}
 							});
@@ -483,8 +645,7 @@ void Game::setupLuaFunctions()
 							{
 								std::shared_ptr<SpineObject> obj = (*lua_state)["this"];
 								obj->setVisible(false);
-								std::string lua_object = getLUAPath(obj->getId());
-								lua_state->script(lua_object + ".visible = false");
+								obj->setLuaField("visible", false);
 							});
 
 	/// See SetHidden
@@ -496,8 +657,7 @@ void Game::setupLuaFunctions()
 								if (obj)
 								{
 									obj->setVisible(false);
-									std::string lua_object = getLUAPath(object);
-									lua_state->script(lua_object + ".visible = false");
+									obj->setLuaField("visible", false);
 								}
 							});
 
@@ -507,8 +667,7 @@ void Game::setupLuaFunctions()
 							{
 								std::shared_ptr<SpineObject> obj = (*lua_state)["this"];
 								obj->setVisible(true);
-								std::string lua_object = getLUAPath(obj->getId());
-								lua_state->script(lua_object + ".visible = true");
+								obj->setLuaField("visible", true);
 							});
 
 	/// See SetVisible
@@ -520,8 +679,7 @@ void Game::setupLuaFunctions()
 								if (obj)
 								{
 									obj->setVisible(true);
-									std::string lua_object = getLUAPath(object);
-									lua_state->script(lua_object + ".visible = true");
+									obj->setLuaField("visible", true);
 								}
 							});
 
@@ -532,8 +690,7 @@ void Game::setupLuaFunctions()
 							{
 								std::shared_ptr<SpineObject> obj = (*lua_state)["this"];
 								obj->layer = layer;
-								std::string lua_object = getLUAPath(obj->getId());
-								lua_state->script(lua_object + ".layer = " + std::to_string(layer));
+								obj->setLuaField("layer", layer);
 							});
 
 	/// See SetLayer
@@ -545,8 +702,7 @@ void Game::setupLuaFunctions()
 								if (obj)
 								{
 									obj->layer = layer;
-									std::string lua_object = getLUAPath(object);
-									lua_state->script(lua_object + ".layer = " + std::to_string(layer));
+									obj->setLuaField("layer", layer);
 								}
 							});
 
@@ -0,0 +1,196 @@
+#include "lua_profiler.hpp"
+
+#include <jngl/debug.hpp>
+
+#ifdef SOL_LUAJIT
+#include <luajit.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+    /// Instructions between two samples
+    constexpr int SAMPLE_INSTRUCTIONS = 1000;
+
+    /// Only one Lua state is profiled at a time, the hook has no user data
+    LuaProfiler *activeProfiler = nullptr;
+
+    double seconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+
+    void writeEntries(std::ofstream &file, const std::map<std::string, LuaProfiler::Entry> &entries, const char *countName)
+    {
+        std::vector<std::pair<std::string, LuaProfiler::Entry>> sorted(entries.begin(), entries.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto &lhs, const auto &rhs)
+                  { return lhs.second.totalSeconds > rhs.second.totalSeconds; });
+        file << std::setw(10) << "total ms" << std::setw(10) << "self ms" << std::setw(10) << countName << std::setw(12)
+             << "allocations"
+             << "  name\n";
+        for (const auto &[name, entry] : sorted)
+        {
+            file << std::setw(10) << entry.totalSeconds * 1000 << std::setw(10) << entry.selfSeconds * 1000 << std::setw(10)
+                 << entry.count << std::setw(12) << entry.allocations << "  " << name << "\n";
+        }
+    }
+} // namespace
+
+LuaProfiler::Scope::Scope(LuaProfiler &profiler, const char *category, const std::string &name)
+{
+    if (!profiler.isEnabled())
+    {
+        return;
+    }
+    this->profiler = &profiler;
+    key = std::string(category) + ":" + name;
+    start = std::chrono::steady_clock::now();
+    allocations = profiler.allocations;
+    parent = profiler.currentScope;
+    profiler.currentScope = this;
+    if (profiler.scopeDepth++ == 0)
+    {
+        profiler.lastSample = start;
+        profiler.allocationsAtSample = profiler.allocations;
+    }
+}
+
+LuaProfiler::Scope::~Scope()
+{
+    // The profiler may have been stopped by the script itself
+    if (!profiler || !profiler->isEnabled())
+    {
+        return;
+    }
+    --profiler->scopeDepth;
+    profiler->currentScope = parent;
+    const double elapsed = seconds(std::chrono::steady_clock::now() - start);
+    if (parent)
+    {
+        parent->childSeconds += elapsed;
+    }
+    auto &entry = profiler->scopes[key];
+    ++entry.count;
+    entry.totalSeconds += elapsed;
+    entry.selfSeconds += elapsed - childSeconds;
+    entry.allocations += profiler->allocations - allocations;
+}
+
+LuaProfiler::~LuaProfiler()
+{
+    if (isEnabled())
+    {
+        lua_sethook(lua, nullptr, 0, 0);
+        lua_setallocf(lua, originalAllocator, originalAllocatorData);
+        activeProfiler = nullptr;
+    }
+}
+
+void LuaProfiler::start(lua_State *lua)
+{
+    if (isEnabled() || activeProfiler)
+    {
+        return;
+    }
+    this->lua = lua;
+    activeProfiler = this;
+    scopes.clear();
+    functions.clear();
+    allocations = 0;
+    scopeDepth = 0;
+    currentScope = nullptr;
+    originalAllocator = lua_getallocf(lua, &originalAllocatorData);
+    lua_setallocf(lua, &LuaProfiler::allocate, this);
+    // Coroutines created from now on inherit the hook
+    lua_sethook(lua, &LuaProfiler::hook, LUA_MASKCOUNT, SAMPLE_INSTRUCTIONS);
+#ifdef SOL_LUAJIT
+    // Compiled traces don't call count hooks, profile the interpreter instead
+    luaJIT_setmode(lua, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+#endif
+}
+
+void LuaProfiler::stop(const std::string &filename)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+    lua_sethook(lua, nullptr, 0, 0);
+    lua_setallocf(lua, originalAllocator, originalAllocatorData);
+#ifdef SOL_LUAJIT
+    luaJIT_setmode(lua, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_ON);
+#endif
+    lua = nullptr;
+    activeProfiler = nullptr;
+
+    std::ofstream file(filename);
+    file << std::fixed << std::setprecision(3);
+    file << "Entry points\n";
+    writeEntries(file, scopes, "calls");
+    file << "\nLua functions\n";
+    writeEntries(file, functions, "samples");
+    jngl::debugLn("Wrote Lua profile to " + filename);
+}
+
+void LuaProfiler::hook(lua_State *thread, lua_Debug *)
+{
+    if (activeProfiler)
+    {
+        activeProfiler->sample(thread);
+    }
+}
+
+void *LuaProfiler::allocate(void *userData, void *pointer, size_t oldSize, size_t newSize)
+{
+    auto profiler = static_cast<LuaProfiler *>(userData);
+    // Lua passes the type instead of the old size for new blocks
+    if (newSize > 0 && (!pointer || newSize > oldSize))
+    {
+        ++profiler->allocations;
+    }
+    return profiler->originalAllocator(profiler->originalAllocatorData, pointer, oldSize, newSize);
+}
+
+void LuaProfiler::sample(lua_State *thread)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = seconds(now - lastSample);
+    const size_t newAllocations = allocations - allocationsAtSample;
+    lastSample = now;
+    allocationsAtSample = allocations;
+    if (scopeDepth == 0)
+    {
+        return;
+    }
+
+    stack.clear();
+    lua_Debug debug;
+    for (int level = 0; lua_getstack(thread, level, &debug); ++level)
+    {
+        lua_getinfo(thread, "Sn", &debug);
+        std::string name = std::string(debug.short_src) + ":" + std::to_string(debug.linedefined);
+        if (debug.name)
+        {
+            name += " " + std::string(debug.name);
+        }
+        // Recursive functions only count once for the total
+        if (std::find(stack.begin(), stack.end(), name) == stack.end())
+        {
+            stack.push_back(std::move(name));
+        }
+    }
+    for (size_t i = 0; i < stack.size(); ++i)
+    {
+        auto &entry = functions[stack[i]];
+        entry.totalSeconds += elapsed;
+        if (i == 0)
+        {
+            ++entry.count;
+            entry.selfSeconds += elapsed;
+            entry.allocations += newAllocations;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <sol/sol.hpp>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+/// Finds the scripts that make a step expensive.
+/// Lua functions are sampled with an instruction count hook, the time since the previous sample
+/// is added to the running function (self) and every function on the stack (total). Scopes measure
+/// the engine's entry points into Lua like actions, callbacks and Spine events.
+/// Allocations of the Lua state are counted for both.
+class LuaProfiler
+{
+public:
+    struct Entry
+    {
+        /// Calls for scopes, samples for functions
+        size_t count = 0;
+        double selfSeconds = 0;
+        double totalSeconds = 0;
+        size_t allocations = 0;
+    };
+
+    /// Time and allocations of an entry point while the profiler is running
+    class Scope
+    {
+    public:
+        Scope(LuaProfiler &profiler, const char *category, const std::string &name);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        LuaProfiler *profiler = nullptr;
+        Scope *parent = nullptr;
+        std::string key;
+        /// Time of the nested scopes, not part of the self time
+        double childSeconds = 0;
+        std::chrono::steady_clock::time_point start;
+        size_t allocations = 0;
+    };
+
+    ~LuaProfiler();
+
+    void start(lua_State *lua);
+    /// Stops profiling and writes the report sorted by total time to filename
+    void stop(const std::string &filename);
+    bool isEnabled() const { return lua != nullptr; }
+
+private:
+    static void hook(lua_State *thread, lua_Debug *debug);
+    static void *allocate(void *userData, void *pointer, size_t oldSize, size_t newSize);
+    void sample(lua_State *thread);
+
+    lua_State *lua = nullptr;
+    lua_Alloc originalAllocator = nullptr;
+    void *originalAllocatorData = nullptr;
+    size_t allocations = 0;
+    size_t allocationsAtSample = 0;
+    std::chrono::steady_clock::time_point lastSample;
+    /// Samples outside of scopes would count the time the engine spent between two scripts
+    int scopeDepth = 0;
+    Scope *currentScope = nullptr;
+    std::map<std::string, Entry> scopes;
+    std::map<std::string, Entry> functions;
+    /// Reused by every sample
+    std::vector<std::string> stack;
+};
@@ -0,0 +1,171 @@
+#include "nav_agent.hpp"
+
+#include "background.hpp"
+#include "job_system.hpp"
+#include "player.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    double length(jngl::Vec2 vector)
+    {
+        return std::sqrt(boost::qvm::dot(vector, vector));
+    }
+} // namespace
+
+NavAgent::NavAgent(std::weak_ptr<SpineObject> owner, float maxSpeed, float radius)
+    : owner(std::move(owner)), maxSpeed(maxSpeed), radius(radius)
+{
+}
+
+void NavAgent::walkTo(jngl::Vec2 target, std::function<void()> onArrival)
+{
+    requestedTarget = target;
+    path.clear();
+    this->onArrival = std::move(onArrival);
+}
+
+void NavAgent::stop()
+{
+    requestedTarget.reset();
+    path.clear();
+    onArrival = nullptr;
+}
+
+void NavCrowd::add(std::weak_ptr<NavAgent> agent)
+{
+    agents.emplace_back(std::move(agent));
+}
+
+void NavCrowd::step(const Background &background, JobSystem &jobSystem, Player *player)
+{
+    activeAgents.clear();
+    positions.clear();
+    pathRequests.clear();
+    agents.erase(std::remove_if(agents.begin(), agents.end(),
+                                [this](const std::weak_ptr<NavAgent> &weak)
+                                {
+                                    auto agent = weak.lock();
+                                    auto owner = agent ? agent->owner.lock() : nullptr;
+                                    if (!owner)
+                                    {
+                                        return true;
+                                    }
+                                    activeAgents.push_back(agent);
+                                    positions.push_back(owner->getPosition());
+                                    return false;
+                                }),
+                 agents.end());
+
+    for (size_t i = 0; i < activeAgents.size(); ++i)
+    {
+        if (activeAgents[i]->requestedTarget)
+        {
+            pathRequests.push_back({activeAgents[i].get(), positions[i], *activeAgents[i]->requestedTarget, {}});
+            activeAgents[i]->requestedTarget.reset();
+        }
+    }
+    // The background isn't changed during the search, so all requests can share it
+    jobSystem.parallelFor(pathRequests.size(), [this, &background](size_t i)
+                          {
+                              auto &request = pathRequests[i];
+                              request.path = background.getPathToTarget(request.start, request.target);
+                          });
+
+    std::vector<std::function<void()>> arrivals;
+    for (auto &request : pathRequests)
+    {
+        if (!request.path.empty() && request.path.front() == request.start)
+        {
+            request.path.pop_front();
+        }
+        request.agent->path = std::move(request.path);
+        // Unreachable targets end the walk right away
+        if (request.agent->path.empty() && request.agent->onArrival)
+        {
+            arrivals.emplace_back(std::move(request.agent->onArrival));
+            request.agent->onArrival = nullptr;
+        }
+    }
+
+    for (size_t i = 0; i < activeAgents.size(); ++i)
+    {
+        NavAgent &agent = *activeAgents[i];
+        if (agent.path.empty())
+        {
+            continue;
+        }
+
+        const jngl::Vec2 position = positions[i];
+        const double speed = agent.maxSpeed;
+        jngl::Vec2 desired = agent.path.front() - position;
+        const double distance = length(desired);
+        const bool reached = distance <= speed;
+        if (!reached)
+        {
+            desired *= speed / distance;
+        }
+
+        // Separation from every overlapping agent and the player, the number of agents in a scene
+        // is small. The sideways part makes agents walking towards each other pass on their right.
+        // An agent at its waypoint isn't pushed, so that it can't be kept from arriving.
+        jngl::Vec2 push(0, 0);
+        const auto separate = [&push, position, &agent](jngl::Vec2 neighbour, float neighbourRadius)
+        {
+            const jngl::Vec2 away = position - neighbour;
+            const double gap = length(away);
+            const double minimum = agent.radius + neighbourRadius;
+            if (gap >= minimum || gap == 0)
+            {
+                return;
+            }
+            const jngl::Vec2 direction = away / gap;
+            push += (direction + jngl::Vec2(-direction.y, direction.x)) * ((minimum - gap) * 0.5);
+        };
+        for (size_t j = 0; !reached && j < activeAgents.size(); ++j)
+        {
+            if (j != i)
+            {
+                separate(positions[j], activeAgents[j]->radius);
+            }
+        }
+        if (!reached && player)
+        {
+            separate(player->getPosition(), player->getRadius());
+        }
+
+        jngl::Vec2 velocity = desired + push;
+        const double velocityLength = length(velocity);
+        if (velocityLength > speed && velocityLength > 0)
+        {
+            velocity *= speed / velocityLength;
+        }
+        jngl::Vec2 next = position + velocity;
+        if (!background.isInWalkableArea(next))
+        {
+            next = position + desired;
+        }
+        if (auto owner = agent.owner.lock())
+        {
+            owner->setPosition(next);
+        }
+
+        if (reached)
+        {
+            agent.path.pop_front();
+            if (agent.path.empty() && agent.onArrival)
+            {
+                arrivals.emplace_back(std::move(agent.onArrival));
+                agent.onArrival = nullptr;
+            }
+        }
+    }
+
+    // Last, because the callbacks may start new walks
+    for (auto &arrival : arrivals)
+    {
+        arrival();
+    }
+}
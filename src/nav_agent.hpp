@@ -0,0 +1,69 @@
+#pragma once
+
+#include <jngl/Vec2.hpp>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class Background;
+class JobSystem;
+class Player;
+class SpineObject;
+
+/// Lets an object walk over the navmesh of the scene.
+/// Agents don't move on their own, a NavCrowd moves all of them together.
+class NavAgent
+{
+public:
+    NavAgent(std::weak_ptr<SpineObject> owner, float maxSpeed, float radius);
+
+    /// Walks to target. onArrival is called when it's reached or turned out to be unreachable,
+    /// but not if the walk is replaced or stopped before.
+    void walkTo(jngl::Vec2 target, std::function<void()> onArrival);
+    void stop();
+    bool isWalking() const { return requestedTarget || !path.empty(); }
+
+    void setMaxSpeed(float speed) { maxSpeed = speed; }
+
+private:
+    friend class NavCrowd;
+
+    std::weak_ptr<SpineObject> owner;
+    float maxSpeed;
+    /// Other agents are kept this far away
+    float radius;
+    /// Set by walkTo until the path has been searched
+    std::optional<jngl::Vec2> requestedTarget;
+    /// Remaining points to walk to, without the current position
+    std::deque<jngl::Vec2> path;
+    std::function<void()> onArrival;
+};
+
+/// Moves all agents of the scene. Paths requested during a step are searched in one batch on the
+/// job system, afterwards every walking agent steers away from the agents and the player it overlaps.
+class NavCrowd
+{
+public:
+    void add(std::weak_ptr<NavAgent> agent);
+    /// Main thread only, the onArrival callbacks are called from here.
+    /// The player walks on its own, agents avoid it like an agent standing still. May be null.
+    void step(const Background &background, JobSystem &jobSystem, Player *player);
+
+private:
+    struct PathRequest
+    {
+        NavAgent *agent;
+        jngl::Vec2 start;
+        jngl::Vec2 target;
+        std::deque<jngl::Vec2> path;
+    };
+
+    std::vector<std::weak_ptr<NavAgent>> agents;
+    /// Reused every step
+    std::vector<std::shared_ptr<NavAgent>> activeAgents;
+    std::vector<jngl::Vec2> positions;
+    std::vector<PathRequest> pathRequests;
+};
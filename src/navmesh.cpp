@@ -0,0 +1,1125 @@
+#include "navmesh.hpp"
+
+#include <jngl/debug.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <utility>
+
+namespace
+{
+    constexpr double EPSILON = 1e-6;
+    /// Triangles are added to all cells their bounding box grown by this touches
+    constexpr double GRID_MARGIN = 1e-3;
+    /// Upper limit for the columns and rows of the triangle grid
+    constexpr int MAX_GRID_CELLS = 256;
+
+    std::atomic<uint64_t> nextVersion{1};
+
+    /// > 0 if c is left of a -> b (counter-clockwise), < 0 if right, 0 if collinear
+    double cross(jngl::Vec2 a, jngl::Vec2 b, jngl::Vec2 c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    double distance(jngl::Vec2 a, jngl::Vec2 b)
+    {
+        return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+    }
+
+    bool almostEqual(jngl::Vec2 a, jngl::Vec2 b)
+    {
+        return std::abs(a.x - b.x) < EPSILON && std::abs(a.y - b.y) < EPSILON;
+    }
+
+    double signedArea(const NavMesh::Polygon &polygon)
+    {
+        double area = 0;
+        for (size_t i = 0; i < polygon.size(); ++i)
+        {
+            const auto &a = polygon[i];
+            const auto &b = polygon[(i + 1) % polygon.size()];
+            area += a.x * b.y - b.x * a.y;
+        }
+        return area / 2;
+    }
+
+    bool containsPoint(const NavMesh::Polygon &polygon, jngl::Vec2 point)
+    {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+        {
+            const auto &a = polygon[i];
+            const auto &b = polygon[j];
+            if ((a.y > point.y) != (b.y > point.y) && point.x < (b.x - a.x) * (point.y - a.y) / (b.y - a.y) + a.x)
+            {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    /// Touching counts as intersecting
+    bool segmentsIntersect(jngl::Vec2 a, jngl::Vec2 b, jngl::Vec2 c, jngl::Vec2 d)
+    {
+        const double d1 = cross(c, d, a);
+        const double d2 = cross(c, d, b);
+        const double d3 = cross(a, b, c);
+        const double d4 = cross(a, b, d);
+        if (((d1 > EPSILON && d2 < -EPSILON) || (d1 < -EPSILON && d2 > EPSILON)) &&
+            ((d3 > EPSILON && d4 < -EPSILON) || (d3 < -EPSILON && d4 > EPSILON)))
+        {
+            return true;
+        }
+        auto onSegment = [](jngl::Vec2 p, jngl::Vec2 q, jngl::Vec2 r, double orientation)
+        {
+            return std::abs(orientation) <= EPSILON && std::min(p.x, q.x) - EPSILON <= r.x && r.x <= std::max(p.x, q.x) + EPSILON &&
+                   std::min(p.y, q.y) - EPSILON <= r.y && r.y <= std::max(p.y, q.y) + EPSILON;
+        };
+        return onSegment(c, d, a, d1) || onSegment(c, d, b, d2) || onSegment(a, b, c, d3) || onSegment(a, b, d, d4);
+    }
+
+    bool triangleContains(jngl::Vec2 a, jngl::Vec2 b, jngl::Vec2 c, jngl::Vec2 point)
+    {
+        return cross(a, b, point) >= -EPSILON && cross(b, c, point) >= -EPSILON && cross(c, a, point) >= -EPSILON;
+    }
+
+    /// Every vertex of polygon inside of outline and no edges crossing
+    bool insideOutline(const NavMesh::Polygon &outline, const NavMesh::Polygon &polygon)
+    {
+        for (const auto &point : polygon)
+        {
+            if (!containsPoint(outline, point))
+            {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < polygon.size(); ++i)
+        {
+            for (size_t j = 0; j < outline.size(); ++j)
+            {
+                if (segmentsIntersect(polygon[i], polygon[(i + 1) % polygon.size()], outline[j], outline[(j + 1) % outline.size()]))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool polygonsOverlap(const NavMesh::Polygon &a, const NavMesh::Polygon &b)
+    {
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            for (size_t j = 0; j < b.size(); ++j)
+            {
+                if (segmentsIntersect(a[i], a[(i + 1) % a.size()], b[j], b[(j + 1) % b.size()]))
+                {
+                    return true;
+                }
+            }
+        }
+        return containsPoint(a, b.front()) || containsPoint(b, a.front());
+    }
+
+    /// Andrew's monotone chain, counter-clockwise
+    NavMesh::Polygon convexHull(NavMesh::Polygon points)
+    {
+        std::sort(points.begin(), points.end(), [](jngl::Vec2 a, jngl::Vec2 b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+        if (points.size() < 3)
+        {
+            return points;
+        }
+        NavMesh::Polygon hull(points.size() * 2);
+        size_t count = 0;
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            while (count >= 2 && cross(hull[count - 2], hull[count - 1], points[i]) <= 0)
+            {
+                --count;
+            }
+            hull[count++] = points[i];
+        }
+        for (size_t i = points.size() - 1, lower = count + 1; i > 0; --i)
+        {
+            while (count >= lower && cross(hull[count - 2], hull[count - 1], points[i - 1]) <= 0)
+            {
+                --count;
+            }
+            hull[count++] = points[i - 1];
+        }
+        hull.resize(count - 1);
+        return hull;
+    }
+
+    jngl::Vec2 closestPointOnSegment(jngl::Vec2 a, jngl::Vec2 b, jngl::Vec2 point)
+    {
+        const double lengthSquared = (b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y);
+        if (lengthSquared < EPSILON)
+        {
+            return a;
+        }
+        const double t = std::clamp(((point.x - a.x) * (b.x - a.x) + (point.y - a.y) * (b.y - a.y)) / lengthSquared, 0.0, 1.0);
+        return jngl::Vec2(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y));
+    }
+} // namespace
+
+NavMesh::NavMesh(const std::vector<Polygon> &outlines, const std::vector<Polygon> &holes) : version(nextVersion++)
+{
+    for (const auto &outline : outlines)
+    {
+        if (outline.size() < 3)
+        {
+            continue;
+        }
+        Area area;
+        area.outline = outline;
+        for (const auto &hole : holes)
+        {
+            if (hole.size() >= 3 && containsPoint(outline, hole.front()))
+            {
+                area.holes.push_back(hole);
+            }
+        }
+        buildArea(area);
+
+        auto base = std::make_shared<Triangulation>();
+        base->vertices.assign(vertices.begin() + area.firstVertex, vertices.begin() + area.firstVertex + area.vertexCount);
+        for (size_t t = area.firstTriangle; t < area.firstTriangle + area.triangleCount; ++t)
+        {
+            Triangle triangle = triangles[t];
+            for (int i = 0; i < 3; ++i)
+            {
+                triangle.vertices[i] -= int(area.firstVertex);
+                if (triangle.neighbours[i] >= 0)
+                {
+                    triangle.neighbours[i] -= int(area.firstTriangle);
+                }
+            }
+            base->triangles.push_back(triangle);
+        }
+        area.base = std::move(base);
+        areas.push_back(std::move(area));
+    }
+    buildGrid();
+}
+
+NavMesh::NavMesh(const NavMesh &previous, const std::vector<Polygon> &obstacles) : version(nextVersion++)
+{
+    for (const auto &previousArea : previous.areas)
+    {
+        Area area;
+        area.outline = previousArea.outline;
+        area.holes = previousArea.holes;
+        area.base = previousArea.base;
+        for (const auto &obstacle : obstacles)
+        {
+            if (obstacle.size() >= 3 && insideOutline(area.outline, obstacle))
+            {
+                area.obstacles.push_back(obstacle);
+            }
+        }
+        if (area.obstacles == previousArea.obstacles)
+        {
+            copyArea(previous, previousArea, area);
+        }
+        else if (area.obstacles.empty())
+        {
+            copyBase(area);
+        }
+        else if (!patchArea(area))
+        {
+            buildArea(area);
+        }
+        areas.push_back(std::move(area));
+    }
+    buildGrid();
+}
+
+void NavMesh::buildArea(Area &area)
+{
+    area.firstVertex = vertices.size();
+    area.firstTriangle = triangles.size();
+
+    // Obstacles become convex, overlapping ones are merged together and with the static holes
+    std::vector<Polygon> holes = area.holes;
+    std::vector<Polygon> merged;
+    for (const auto &obstacle : area.obstacles)
+    {
+        merged.push_back(convexHull(obstacle));
+    }
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 0; i < merged.size() && !changed; ++i)
+        {
+            for (size_t j = i + 1; j < merged.size() && !changed; ++j)
+            {
+                if (polygonsOverlap(merged[i], merged[j]))
+                {
+                    Polygon points = merged[i];
+                    points.insert(points.end(), merged[j].begin(), merged[j].end());
+                    merged[i] = convexHull(points);
+                    merged.erase(merged.begin() + j);
+                    changed = true;
+                }
+            }
+            for (size_t j = 0; j < holes.size() && !changed; ++j)
+            {
+                if (polygonsOverlap(merged[i], holes[j]))
+                {
+                    Polygon points = merged[i];
+                    points.insert(points.end(), holes[j].begin(), holes[j].end());
+                    merged[i] = convexHull(points);
+                    holes.erase(holes.begin() + j);
+                    changed = true;
+                }
+            }
+        }
+    }
+    std::vector<const Polygon *> holePointers;
+    for (const auto &hole : holes)
+    {
+        holePointers.push_back(&hole);
+    }
+    for (const auto &obstacle : merged)
+    {
+        // The hull of merged obstacles can reach out of the area
+        if (insideOutline(area.outline, obstacle))
+        {
+            holePointers.push_back(&obstacle);
+        }
+    }
+    triangulate(area.outline, holePointers);
+
+    area.vertexCount = vertices.size() - area.firstVertex;
+    area.triangleCount = triangles.size() - area.firstTriangle;
+    connectNeighbours(area.firstTriangle);
+}
+
+void NavMesh::copyArea(const NavMesh &other, const Area &source, Area &area)
+{
+    const int vertexOffset = int(vertices.size()) - int(source.firstVertex);
+    const int triangleOffset = int(triangles.size()) - int(source.firstTriangle);
+    area.firstVertex = vertices.size();
+    area.firstTriangle = triangles.size();
+    area.vertexCount = source.vertexCount;
+    area.triangleCount = source.triangleCount;
+    vertices.insert(vertices.end(), other.vertices.begin() + source.firstVertex,
+                    other.vertices.begin() + source.firstVertex + source.vertexCount);
+    for (size_t t = source.firstTriangle; t < source.firstTriangle + source.triangleCount; ++t)
+    {
+        Triangle triangle = other.triangles[t];
+        for (int i = 0; i < 3; ++i)
+        {
+            triangle.vertices[i] += vertexOffset;
+            if (triangle.neighbours[i] >= 0)
+            {
+                triangle.neighbours[i] += triangleOffset;
+            }
+        }
+        triangles.push_back(triangle);
+    }
+}
+
+void NavMesh::copyBase(Area &area)
+{
+    const int vertexOffset = int(vertices.size());
+    const int triangleOffset = int(triangles.size());
+    area.firstVertex = vertices.size();
+    area.firstTriangle = triangles.size();
+    area.vertexCount = area.base->vertices.size();
+    area.triangleCount = area.base->triangles.size();
+    vertices.insert(vertices.end(), area.base->vertices.begin(), area.base->vertices.end());
+    for (Triangle triangle : area.base->triangles)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            triangle.vertices[i] += vertexOffset;
+            if (triangle.neighbours[i] >= 0)
+            {
+                triangle.neighbours[i] += triangleOffset;
+            }
+        }
+        triangles.push_back(triangle);
+    }
+}
+
+bool NavMesh::patchArea(Area &area)
+{
+    const Triangulation &base = *area.base;
+
+    // Obstacles become convex and overlapping ones are merged. Merging with the static holes
+    // changes the border of the area, that's left to buildArea.
+    std::vector<Polygon> merged;
+    for (const auto &obstacle : area.obstacles)
+    {
+        merged.push_back(convexHull(obstacle));
+    }
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 0; i < merged.size() && !changed; ++i)
+        {
+            for (size_t j = i + 1; j < merged.size() && !changed; ++j)
+            {
+                if (polygonsOverlap(merged[i], merged[j]))
+                {
+                    Polygon points = merged[i];
+                    points.insert(points.end(), merged[j].begin(), merged[j].end());
+                    merged[i] = convexHull(points);
+                    merged.erase(merged.begin() + j);
+                    changed = true;
+                }
+            }
+        }
+    }
+    // The hull of merged obstacles can reach out of the area
+    merged.erase(std::remove_if(merged.begin(), merged.end(), [&area](const Polygon &obstacle)
+                                { return obstacle.size() < 3 || !insideOutline(area.outline, obstacle); }),
+                 merged.end());
+    for (const auto &obstacle : merged)
+    {
+        for (const auto &hole : area.holes)
+        {
+            if (polygonsOverlap(obstacle, hole))
+            {
+                return false;
+            }
+        }
+    }
+
+    // The triangles touching an obstacle and their neighbours are triangulated again
+    const size_t triangleCount = base.triangles.size();
+    std::vector<bool> inPatch(triangleCount, false);
+    for (const auto &obstacle : merged)
+    {
+        jngl::Vec2 obstacleMin = obstacle.front();
+        jngl::Vec2 obstacleMax = obstacle.front();
+        for (const auto &point : obstacle)
+        {
+            obstacleMin = jngl::Vec2(std::min(obstacleMin.x, point.x), std::min(obstacleMin.y, point.y));
+            obstacleMax = jngl::Vec2(std::max(obstacleMax.x, point.x), std::max(obstacleMax.y, point.y));
+        }
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            if (inPatch[t])
+            {
+                continue;
+            }
+            const Polygon corners = {base.vertices[base.triangles[t].vertices[0]], base.vertices[base.triangles[t].vertices[1]],
+                                     base.vertices[base.triangles[t].vertices[2]]};
+            const bool separated =
+                std::all_of(corners.begin(), corners.end(), [&](jngl::Vec2 p) { return p.x < obstacleMin.x - EPSILON; }) ||
+                std::all_of(corners.begin(), corners.end(), [&](jngl::Vec2 p) { return p.x > obstacleMax.x + EPSILON; }) ||
+                std::all_of(corners.begin(), corners.end(), [&](jngl::Vec2 p) { return p.y < obstacleMin.y - EPSILON; }) ||
+                std::all_of(corners.begin(), corners.end(), [&](jngl::Vec2 p) { return p.y > obstacleMax.y + EPSILON; });
+            if (!separated && polygonsOverlap(corners, obstacle))
+            {
+                inPatch[t] = true;
+            }
+        }
+    }
+    const std::vector<bool> touched = inPatch;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (int neighbour : base.triangles[t].neighbours)
+        {
+            if (touched[t] && neighbour >= 0)
+            {
+                inPatch[neighbour] = true;
+            }
+        }
+    }
+
+    // Border of the patch, the inside is on the left of every edge. A vertex with more than one
+    // outgoing edge joins two loops, the triangles around it are added until there is none.
+    std::map<int, int> nextBorderVertex;
+    while (true)
+    {
+        nextBorderVertex.clear();
+        std::vector<bool> pinched(base.vertices.size(), false);
+        bool anyPinched = false;
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            if (!inPatch[t])
+            {
+                continue;
+            }
+            const auto &triangle = base.triangles[t];
+            for (int e = 0; e < 3; ++e)
+            {
+                if (triangle.neighbours[e] >= 0 && inPatch[triangle.neighbours[e]])
+                {
+                    continue;
+                }
+                const int from = triangle.vertices[e];
+                if (!nextBorderVertex.emplace(from, triangle.vertices[(e + 1) % 3]).second)
+                {
+                    pinched[from] = true;
+                    anyPinched = true;
+                }
+            }
+        }
+        if (!anyPinched)
+        {
+            break;
+        }
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            const auto &v = base.triangles[t].vertices;
+            if (pinched[v[0]] || pinched[v[1]] || pinched[v[2]])
+            {
+                inPatch[t] = true;
+            }
+        }
+    }
+
+    std::vector<Polygon> outerLoops;
+    std::vector<Polygon> innerLoops;
+    while (!nextBorderVertex.empty())
+    {
+        Polygon loop;
+        const int start = nextBorderVertex.begin()->first;
+        int current = start;
+        do
+        {
+            loop.push_back(base.vertices[current]);
+            const auto next = nextBorderVertex.find(current);
+            if (next == nextBorderVertex.end())
+            {
+                return false;
+            }
+            current = next->second;
+            nextBorderVertex.erase(next);
+        } while (current != start);
+        (signedArea(loop) > 0 ? outerLoops : innerLoops).push_back(std::move(loop));
+    }
+
+    // Untouched triangles are copied, the vertices inside of the patch are dropped below
+    area.firstVertex = vertices.size();
+    area.firstTriangle = triangles.size();
+    vertices.insert(vertices.end(), base.vertices.begin(), base.vertices.end());
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if (!inPatch[t])
+        {
+            Triangle triangle = base.triangles[t];
+            for (int &index : triangle.vertices)
+            {
+                index += int(area.firstVertex);
+            }
+            triangles.push_back(triangle);
+        }
+    }
+
+    // Every obstacle and every inner loop belongs to the smallest outer loop around it
+    auto smallestOuterLoop = [&outerLoops](jngl::Vec2 point)
+    {
+        size_t result = SIZE_MAX;
+        for (size_t i = 0; i < outerLoops.size(); ++i)
+        {
+            if (containsPoint(outerLoops[i], point) &&
+                (result == SIZE_MAX || signedArea(outerLoops[i]) < signedArea(outerLoops[result])))
+            {
+                result = i;
+            }
+        }
+        return result;
+    };
+    std::vector<std::vector<const Polygon *>> loopHoles(outerLoops.size());
+    for (const auto &loop : innerLoops)
+    {
+        const size_t outer = smallestOuterLoop(loop.front());
+        if (outer != SIZE_MAX)
+        {
+            loopHoles[outer].push_back(&loop);
+        }
+    }
+    for (const auto &obstacle : merged)
+    {
+        const size_t outer = smallestOuterLoop(obstacle.front());
+        if (outer != SIZE_MAX)
+        {
+            loopHoles[outer].push_back(&obstacle);
+        }
+    }
+    const size_t patchVertices = vertices.size();
+    for (size_t i = 0; i < outerLoops.size(); ++i)
+    {
+        triangulate(outerLoops[i], loopHoles[i]);
+    }
+
+    // The patch's border vertices are the same as the ones of the copied triangles
+    std::map<std::pair<double, double>, int> borderVertices;
+    for (size_t i = area.firstVertex; i < patchVertices; ++i)
+    {
+        borderVertices.emplace(std::make_pair(vertices[i].x, vertices[i].y), int(i));
+    }
+    std::vector<int> remap(vertices.size() - area.firstVertex, -1);
+    std::vector<jngl::Vec2> usedVertices;
+    for (size_t t = area.firstTriangle; t < triangles.size(); ++t)
+    {
+        triangles[t].neighbours = {-1, -1, -1};
+        for (int &index : triangles[t].vertices)
+        {
+            if (size_t(index) >= patchVertices)
+            {
+                const auto border = borderVertices.find(std::make_pair(vertices[index].x, vertices[index].y));
+                if (border != borderVertices.end())
+                {
+                    index = border->second;
+                }
+            }
+            int &compacted = remap[index - area.firstVertex];
+            if (compacted < 0)
+            {
+                compacted = int(area.firstVertex + usedVertices.size());
+                usedVertices.push_back(vertices[index]);
+            }
+            index = compacted;
+        }
+    }
+    vertices.resize(area.firstVertex);
+    vertices.insert(vertices.end(), usedVertices.begin(), usedVertices.end());
+
+    area.vertexCount = vertices.size() - area.firstVertex;
+    area.triangleCount = triangles.size() - area.firstTriangle;
+    connectNeighbours(area.firstTriangle);
+    return true;
+}
+
+void NavMesh::addPolygon(const Polygon &polygon, bool counterClockwise, std::vector<int> &indices)
+{
+    indices.clear();
+    for (const auto &point : polygon)
+    {
+        // Repeated points, e.g. the closing vertex, would create degenerated triangles
+        if (!indices.empty() && almostEqual(vertices[indices.back()], point))
+        {
+            continue;
+        }
+        indices.push_back(static_cast<int>(vertices.size()));
+        vertices.push_back(point);
+    }
+    if (indices.size() > 1 && almostEqual(vertices[indices.front()], vertices[indices.back()]))
+    {
+        indices.pop_back();
+    }
+    if ((signedArea(polygon) > 0) != counterClockwise)
+    {
+        std::reverse(indices.begin(), indices.end());
+    }
+}
+
+void NavMesh::triangulate(const Polygon &area, const std::vector<const Polygon *> &holes)
+{
+    std::vector<int> ring;
+    addPolygon(area, true, ring);
+
+    std::vector<std::vector<int>> holeRings(holes.size());
+    for (size_t i = 0; i < holes.size(); ++i)
+    {
+        addPolygon(*holes[i], false, holeRings[i]);
+    }
+
+    // Holes further right first, so that bridges of later holes can't cross them
+    auto maxX = [this](const std::vector<int> &hole)
+    {
+        double result = -std::numeric_limits<double>::infinity();
+        for (int index : hole)
+        {
+            result = std::max(result, vertices[index].x);
+        }
+        return result;
+    };
+    std::sort(holeRings.begin(), holeRings.end(),
+              [&maxX](const std::vector<int> &a, const std::vector<int> &b) { return maxX(a) > maxX(b); });
+
+    for (size_t i = 0; i < holeRings.size(); ++i)
+    {
+        const std::vector<std::vector<int>> remaining(holeRings.begin() + i + 1, holeRings.end());
+        if (holeRings[i].size() < 3 || !bridgeHole(ring, holeRings[i], remaining))
+        {
+            jngl::debugLn("Could not connect a hole of the walkable area, it will be ignored.");
+        }
+    }
+
+    earClip(std::move(ring));
+}
+
+bool NavMesh::bridgeHole(std::vector<int> &ring, const std::vector<int> &hole, const std::vector<std::vector<int>> &otherHoles) const
+{
+    auto crossesEdge = [this](int from, int to, const std::vector<int> &polygon)
+    {
+        for (size_t i = 0; i < polygon.size(); ++i)
+        {
+            const int a = polygon[i];
+            const int b = polygon[(i + 1) % polygon.size()];
+            if (a == from || a == to || b == from || b == to)
+            {
+                continue;
+            }
+            if (segmentsIntersect(vertices[from], vertices[to], vertices[a], vertices[b]))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    double bestDistance = std::numeric_limits<double>::infinity();
+    size_t bestRingPosition = 0;
+    size_t bestHolePosition = 0;
+    for (size_t h = 0; h < hole.size(); ++h)
+    {
+        for (size_t r = 0; r < ring.size(); ++r)
+        {
+            const int from = hole[h];
+            const int to = ring[r];
+            const double length = distance(vertices[from], vertices[to]);
+            // Vertices already used by a bridge appear twice, the bridge could end up on the wrong side
+            if (length >= bestDistance || std::count(ring.begin(), ring.end(), to) > 1)
+            {
+                continue;
+            }
+            // The bridge has to leave the hole and enter the ring into their insides
+            const int holePrev = hole[(h + hole.size() - 1) % hole.size()];
+            const int holeNext = hole[(h + 1) % hole.size()];
+            const int ringPrev = ring[(r + ring.size() - 1) % ring.size()];
+            const int ringNext = ring[(r + 1) % ring.size()];
+            auto insideCorner = [this](int prev, int corner, int next, int other)
+            {
+                const auto &p = vertices[prev];
+                const auto &c = vertices[corner];
+                const auto &n = vertices[next];
+                const auto &o = vertices[other];
+                if (cross(p, c, n) >= 0)
+                {
+                    return cross(p, c, o) > EPSILON && cross(c, n, o) > EPSILON;
+                }
+                return cross(p, c, o) > EPSILON || cross(c, n, o) > EPSILON;
+            };
+            if (!insideCorner(ringPrev, to, ringNext, from) || !insideCorner(holePrev, from, holeNext, to))
+            {
+                continue;
+            }
+            if (crossesEdge(from, to, ring) || crossesEdge(from, to, hole) ||
+                std::any_of(otherHoles.begin(), otherHoles.end(),
+                            [&](const std::vector<int> &other) { return crossesEdge(from, to, other); }))
+            {
+                continue;
+            }
+            bestDistance = length;
+            bestRingPosition = r;
+            bestHolePosition = h;
+        }
+    }
+    if (bestDistance == std::numeric_limits<double>::infinity())
+    {
+        return false;
+    }
+
+    // ring[r], hole[h], hole[h + 1], ..., hole[h - 1], hole[h], ring[r], ...
+    std::vector<int> bridged;
+    bridged.reserve(hole.size() + 2);
+    for (size_t i = 0; i <= hole.size(); ++i)
+    {
+        bridged.push_back(hole[(bestHolePosition + i) % hole.size()]);
+    }
+    bridged.push_back(ring[bestRingPosition]);
+    ring.insert(ring.begin() + bestRingPosition + 1, bridged.begin(), bridged.end());
+    return true;
+}
+
+void NavMesh::earClip(std::vector<int> ring)
+{
+    size_t i = 0;
+    size_t attempts = 0;
+    while (ring.size() > 3)
+    {
+        if (attempts > ring.size())
+        {
+            // No ear left, the polygon intersects itself. Drop a flat corner or give up.
+            size_t flat = 0;
+            while (flat < ring.size() &&
+                   std::abs(cross(vertices[ring[(flat + ring.size() - 1) % ring.size()]], vertices[ring[flat]],
+                                  vertices[ring[(flat + 1) % ring.size()]])) > EPSILON)
+            {
+                ++flat;
+            }
+            if (flat == ring.size())
+            {
+                jngl::debugLn("Could not triangulate the walkable area completely.");
+                return;
+            }
+            ring.erase(ring.begin() + flat);
+            attempts = 0;
+            continue;
+        }
+        i %= ring.size();
+        const int prev = ring[(i + ring.size() - 1) % ring.size()];
+        const int current = ring[i];
+        const int next = ring[(i + 1) % ring.size()];
+        const auto &a = vertices[prev];
+        const auto &b = vertices[current];
+        const auto &c = vertices[next];
+
+        bool ear = cross(a, b, c) > EPSILON;
+        for (size_t j = 0; ear && j < ring.size(); ++j)
+        {
+            const int other = ring[j];
+            if (other != prev && other != current && other != next && triangleContains(a, b, c, vertices[other]))
+            {
+                ear = false;
+            }
+        }
+        if (!ear)
+        {
+            ++i;
+            ++attempts;
+            continue;
+        }
+        triangles.push_back({{prev, current, next}, {-1, -1, -1}});
+        ring.erase(ring.begin() + i);
+        attempts = 0;
+    }
+    if (ring.size() == 3 && cross(vertices[ring[0]], vertices[ring[1]], vertices[ring[2]]) > EPSILON)
+    {
+        triangles.push_back({{ring[0], ring[1], ring[2]}, {-1, -1, -1}});
+    }
+}
+
+void NavMesh::connectNeighbours(size_t firstTriangle)
+{
+    // Areas don't share vertices, so only triangles of the same area can be neighbours
+    std::map<std::pair<int, int>, std::pair<int, int>> edges;
+    for (size_t t = firstTriangle; t < triangles.size(); ++t)
+    {
+        for (int e = 0; e < 3; ++e)
+        {
+            const int a = triangles[t].vertices[e];
+            const int b = triangles[t].vertices[(e + 1) % 3];
+            const auto key = std::minmax(a, b);
+            const auto found = edges.find(key);
+            if (found == edges.end())
+            {
+                edges.emplace(key, std::make_pair(static_cast<int>(t), e));
+                continue;
+            }
+            const auto [other, otherEdge] = found->second;
+            triangles[t].neighbours[e] = other;
+            triangles[other].neighbours[otherEdge] = static_cast<int>(t);
+        }
+    }
+}
+
+size_t NavMesh::getMemoryUsage() const
+{
+    auto polygonBytes = [](const Polygon &polygon) { return polygon.capacity() * sizeof(jngl::Vec2); };
+    size_t bytes = sizeof(NavMesh) + vertices.capacity() * sizeof(jngl::Vec2) + triangles.capacity() * sizeof(Triangle) +
+                   areas.capacity() * sizeof(Area);
+    for (const auto &area : areas)
+    {
+        bytes += polygonBytes(area.outline) + (area.holes.capacity() + area.obstacles.capacity()) * sizeof(Polygon);
+        for (const auto &hole : area.holes)
+        {
+            bytes += polygonBytes(hole);
+        }
+        for (const auto &obstacle : area.obstacles)
+        {
+            bytes += polygonBytes(obstacle);
+        }
+    }
+    return bytes + cellStart.capacity() * sizeof(uint32_t) + cellTriangles.capacity() * sizeof(int);
+}
+
+void NavMesh::buildGrid()
+{
+    if (triangles.empty())
+    {
+        return;
+    }
+    jngl::Vec2 minimum(std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity());
+    jngl::Vec2 maximum = -1 * minimum;
+    for (const auto &vertex : vertices)
+    {
+        minimum = jngl::Vec2(std::min(minimum.x, vertex.x), std::min(minimum.y, vertex.y));
+        maximum = jngl::Vec2(std::max(maximum.x, vertex.x), std::max(maximum.y, vertex.y));
+    }
+    const double width = std::max(maximum.x - minimum.x, EPSILON);
+    const double height = std::max(maximum.y - minimum.y, EPSILON);
+    // About two triangles per cell
+    gridCellSize = std::max(std::sqrt(width * height * 2 / double(triangles.size())), std::max(width, height) / MAX_GRID_CELLS);
+    gridOrigin = minimum;
+    gridColumns = std::min(int(width / gridCellSize) + 1, MAX_GRID_CELLS);
+    gridRows = std::min(int(height / gridCellSize) + 1, MAX_GRID_CELLS);
+
+    // Counted first, so that all cells share one array
+    auto forEachCell = [this](const Triangle &triangle, const std::function<void(size_t)> &func)
+    {
+        const auto &a = vertices[triangle.vertices[0]];
+        const auto &b = vertices[triangle.vertices[1]];
+        const auto &c = vertices[triangle.vertices[2]];
+        const int firstColumn = gridColumn(std::min({a.x, b.x, c.x}) - GRID_MARGIN);
+        const int lastColumn = gridColumn(std::max({a.x, b.x, c.x}) + GRID_MARGIN);
+        const int firstRow = gridRow(std::min({a.y, b.y, c.y}) - GRID_MARGIN);
+        const int lastRow = gridRow(std::max({a.y, b.y, c.y}) + GRID_MARGIN);
+        for (int row = firstRow; row <= lastRow; ++row)
+        {
+            for (int column = firstColumn; column <= lastColumn; ++column)
+            {
+                func(size_t(row) * gridColumns + column);
+            }
+        }
+    };
+    cellStart.assign(size_t(gridColumns) * gridRows + 1, 0);
+    for (const auto &triangle : triangles)
+    {
+        forEachCell(triangle, [this](size_t cell) { ++cellStart[cell + 1]; });
+    }
+    for (size_t cell = 1; cell < cellStart.size(); ++cell)
+    {
+        cellStart[cell] += cellStart[cell - 1];
+    }
+    cellTriangles.resize(cellStart.back());
+    std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+    for (size_t t = 0; t < triangles.size(); ++t)
+    {
+        forEachCell(triangles[t], [this, &fill, t](size_t cell) { cellTriangles[fill[cell]++] = static_cast<int>(t); });
+    }
+}
+
+int NavMesh::gridColumn(double x) const
+{
+    return int(std::clamp(std::floor((x - gridOrigin.x) / gridCellSize), 0.0, double(gridColumns - 1)));
+}
+
+int NavMesh::gridRow(double y) const
+{
+    return int(std::clamp(std::floor((y - gridOrigin.y) / gridCellSize), 0.0, double(gridRows - 1)));
+}
+
+int NavMesh::findTriangle(jngl::Vec2 position) const
+{
+    if (triangles.empty())
+    {
+        return -1;
+    }
+    const size_t cell = size_t(gridRow(position.y)) * gridColumns + gridColumn(position.x);
+    for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+    {
+        const auto &v = triangles[cellTriangles[i]].vertices;
+        if (triangleContains(vertices[v[0]], vertices[v[1]], vertices[v[2]], position))
+        {
+            return cellTriangles[i];
+        }
+    }
+    return -1;
+}
+
+int NavMesh::findClosestTriangle(jngl::Vec2 position) const
+{
+    const int inside = findTriangle(position);
+    if (inside >= 0)
+    {
+        return inside;
+    }
+    // Rings of cells around the cell of position, until no closer triangle can follow
+    int closest = -1;
+    double closestDistance = std::numeric_limits<double>::infinity();
+    const int column = gridColumn(position.x);
+    const int row = gridRow(position.y);
+    for (int ring = 0; ring <= std::max(gridColumns, gridRows); ++ring)
+    {
+        // Every point of the cells in this ring is at least ring - 1 cells away
+        if (closest >= 0 && closestDistance < (ring - 1) * gridCellSize)
+        {
+            break;
+        }
+        for (int r = std::max(row - ring, 0); r <= std::min(row + ring, gridRows - 1); ++r)
+        {
+            // Only the left and right cell of the rows in between belong to the ring
+            const int step = r == row - ring || r == row + ring ? 1 : 2 * ring;
+            for (int c = column - ring; c <= column + ring; c += step)
+            {
+                if (c < 0 || c >= gridColumns)
+                {
+                    continue;
+                }
+                const size_t cell = size_t(r) * gridColumns + c;
+                for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+                {
+                    const int t = cellTriangles[i];
+                    const auto &v = triangles[t].vertices;
+                    for (int e = 0; e < 3; ++e)
+                    {
+                        const double d = distance(position, closestPointOnSegment(vertices[v[e]], vertices[v[(e + 1) % 3]], position));
+                        // The lowest index wins ties, no matter in which cell it was found first
+                        if (d < closestDistance || (d == closestDistance && t < closest))
+                        {
+                            closestDistance = d;
+                            closest = t;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return closest;
+}
+
+std::deque<jngl::Vec2> NavMesh::findPath(jngl::Vec2 start, jngl::Vec2 target) const
+{
+    std::deque<jngl::Vec2> path;
+    const int startTriangle = findClosestTriangle(start);
+    const int targetTriangle = findClosestTriangle(target);
+    if (startTriangle < 0 || targetTriangle < 0)
+    {
+        return path;
+    }
+
+    // A* over the triangles, every triangle is entered at the middle of an edge.
+    // The buffers are reused by all searches on this thread.
+    struct OpenTriangle
+    {
+        double score;
+        int index;
+        bool operator>(const OpenTriangle &other) const { return score > other.score; }
+    };
+    thread_local std::vector<double> costs;
+    thread_local std::vector<int> parents;
+    thread_local std::vector<jngl::Vec2> entries;
+    thread_local std::vector<bool> closed;
+    thread_local std::vector<OpenTriangle> openHeap;
+    costs.assign(triangles.size(), std::numeric_limits<double>::infinity());
+    parents.assign(triangles.size(), -1);
+    entries.resize(triangles.size());
+    closed.assign(triangles.size(), false);
+    openHeap.clear();
+
+    costs[startTriangle] = 0;
+    entries[startTriangle] = start;
+    openHeap.push_back({distance(start, target), startTriangle});
+    while (!openHeap.empty())
+    {
+        std::pop_heap(openHeap.begin(), openHeap.end(), std::greater<OpenTriangle>());
+        const int current = openHeap.back().index;
+        openHeap.pop_back();
+        if (closed[current])
+        {
+            continue;
+        }
+        closed[current] = true;
+        if (current == targetTriangle)
+        {
+            break;
+        }
+        const auto &triangle = triangles[current];
+        for (int e = 0; e < 3; ++e)
+        {
+            const int neighbour = triangle.neighbours[e];
+            if (neighbour < 0 || closed[neighbour])
+            {
+                continue;
+            }
+            const auto &a = vertices[triangle.vertices[e]];
+            const auto &b = vertices[triangle.vertices[(e + 1) % 3]];
+            const jngl::Vec2 entry((a.x + b.x) / 2, (a.y + b.y) / 2);
+            const double cost = costs[current] + distance(entries[current], entry);
+            if (cost < costs[neighbour])
+            {
+                costs[neighbour] = cost;
+                parents[neighbour] = current;
+                entries[neighbour] = entry;
+                openHeap.push_back({cost + distance(entry, target), neighbour});
+                std::push_heap(openHeap.begin(), openHeap.end(), std::greater<OpenTriangle>());
+            }
+        }
+    }
+    if (!closed[targetTriangle])
+    {
+        return path;
+    }
+
+    // Portals between the triangles of the corridor, seen in walking direction
+    thread_local std::vector<std::pair<jngl::Vec2, jngl::Vec2>> portals;
+    portals.clear();
+    portals.emplace_back(target, target);
+    for (int current = targetTriangle; parents[current] >= 0; current = parents[current])
+    {
+        const auto &from = triangles[parents[current]];
+        for (int e = 0; e < 3; ++e)
+        {
+            if (from.neighbours[e] == current)
+            {
+                // Leaving a counter-clockwise triangle, the edge's end is on the left
+                portals.emplace_back(vertices[from.vertices[(e + 1) % 3]], vertices[from.vertices[e]]);
+                break;
+            }
+        }
+    }
+    portals.emplace_back(start, start);
+    std::reverse(portals.begin(), portals.end());
+
+    // Simple stupid funnel algorithm
+    path.push_back(start);
+    jngl::Vec2 apex = start;
+    jngl::Vec2 left = start;
+    jngl::Vec2 right = start;
+    size_t apexIndex = 0;
+    size_t leftIndex = 0;
+    size_t rightIndex = 0;
+    for (size_t i = 1; i < portals.size(); ++i)
+    {
+        const auto &[portalLeft, portalRight] = portals[i];
+
+        if (cross(apex, right, portalRight) >= 0)
+        {
+            if (almostEqual(apex, right) || cross(apex, left, portalRight) < 0)
+            {
+                right = portalRight;
+                rightIndex = i;
+            }
+            else
+            {
+                // The right side crossed the left one, the left corner is part of the path
+                apex = left;
+                apexIndex = leftIndex;
+                path.push_back(apex);
+                right = left = apex;
+                rightIndex = leftIndex = i = apexIndex;
+                continue;
+            }
+        }
+
+        if (cross(apex, left, portalLeft) <= 0)
+        {
+            if (almostEqual(apex, left) || cross(apex, right, portalLeft) > 0)
+            {
+                left = portalLeft;
+                leftIndex = i;
+            }
+            else
+            {
+                apex = right;
+                apexIndex = rightIndex;
+                path.push_back(apex);
+                right = left = apex;
+                rightIndex = leftIndex = i = apexIndex;
+                continue;
+            }
+        }
+    }
+    if (!almostEqual(path.back(), target))
+    {
+        path.push_back(target);
+    }
+    return path;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <jngl/Vec2.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+/// Triangulated walkable area of a scene.
+/// Paths are searched over the triangles with A* and shortened with the funnel algorithm.
+/// The mesh doesn't change after construction, so it can be shared and searched from any thread.
+class NavMesh
+{
+public:
+    using Polygon = std::vector<jngl::Vec2>;
+
+    struct Triangle
+    {
+        /// Counter-clockwise (positive cross product) indices into the vertices
+        std::array<int, 3> vertices;
+        /// Triangle on the other side of the edge vertices[i] -> vertices[i + 1], -1 on the border
+        std::array<int, 3> neighbours;
+    };
+
+    /// areas: outlines of the walkable areas, holes: obstacles inside of them.
+    /// Every hole belongs to the area containing its first vertex. The winding order doesn't matter.
+    NavMesh(const std::vector<Polygon> &areas, const std::vector<Polygon> &holes);
+
+    /// Copy of previous with other dynamic obstacles, e.g. the blocking_area of objects.
+    /// Only the triangles of the obstacle-free mesh that the obstacles touch are triangulated
+    /// again, the rest is copied. Overlapping obstacles are merged into their convex hull,
+    /// obstacles not completely inside of an area are ignored.
+    NavMesh(const NavMesh &previous, const std::vector<Polygon> &obstacles);
+
+    /// Shortest path from start to target including both, empty if target can't be reached.
+    /// Points slightly outside of the mesh are snapped to the closest triangle.
+    std::deque<jngl::Vec2> findPath(jngl::Vec2 start, jngl::Vec2 target) const;
+
+    /// Index of the triangle containing position, -1 if there is none. Only tests the triangles in
+    /// the grid cell of position.
+    int findTriangle(jngl::Vec2 position) const;
+
+    bool empty() const { return triangles.empty(); }
+    /// Unique for every navmesh ever built, e.g. for caching paths
+    uint64_t getVersion() const { return version; }
+    const std::vector<jngl::Vec2> &getVertices() const { return vertices; }
+    const std::vector<Triangle> &getTriangles() const { return triangles; }
+    /// Bytes allocated for the mesh
+    size_t getMemoryUsage() const;
+
+private:
+    /// Triangles of one area, the vertex indices start at 0
+    struct Triangulation
+    {
+        std::vector<jngl::Vec2> vertices;
+        std::vector<Triangle> triangles;
+    };
+
+    struct Area
+    {
+        Polygon outline;
+        std::vector<Polygon> holes;
+        /// Obstacles as passed in, before they were merged
+        std::vector<Polygon> obstacles;
+        /// Triangulation without obstacles, shared by all meshes derived from the same one
+        std::shared_ptr<const Triangulation> base;
+        size_t firstVertex = 0;
+        size_t vertexCount = 0;
+        size_t firstTriangle = 0;
+        size_t triangleCount = 0;
+    };
+
+    /// Triangulates the area and appends vertices and triangles
+    void buildArea(Area &area);
+    /// Appends the vertices and triangles of the area source of another navmesh
+    void copyArea(const NavMesh &other, const Area &source, Area &area);
+    /// Appends the triangulation of the area without obstacles
+    void copyBase(Area &area);
+    /// Appends the base triangulation with the triangles around the obstacles triangulated again.
+    /// Returns false without changes if that isn't possible, e.g. for obstacles overlapping a hole.
+    bool patchArea(Area &area);
+    /// Appends the triangles of the area minus the holes
+    void triangulate(const Polygon &area, const std::vector<const Polygon *> &holes);
+    /// Inserts a hole into the ring with a bridge to the closest visible ring vertex
+    bool bridgeHole(std::vector<int> &ring, const std::vector<int> &hole, const std::vector<std::vector<int>> &otherHoles) const;
+    void earClip(std::vector<int> ring);
+    /// Connects the triangles starting at firstTriangle
+    void connectNeighbours(size_t firstTriangle);
+    int findClosestTriangle(jngl::Vec2 position) const;
+    /// Buckets the triangles into grid cells by their bounding boxes, called after all areas were added
+    void buildGrid();
+    /// Cell of a coordinate, clamped to the grid
+    int gridColumn(double x) const;
+    int gridRow(double y) const;
+    /// Appends the vertices without repeated points and writes their indices in the requested winding order
+    void addPolygon(const Polygon &polygon, bool counterClockwise, std::vector<int> &indices);
+
+    std::vector<Area> areas;
+    std::vector<jngl::Vec2> vertices;
+    std::vector<Triangle> triangles;
+    /// Uniform grid over the triangles, so that lookups only test the triangles near a point
+    jngl::Vec2 gridOrigin;
+    double gridCellSize = 1;
+    int gridColumns = 0;
+    int gridRows = 0;
+    /// The triangles of cell i are cellTriangles[cellStart[i]] to cellTriangles[cellStart[i + 1]], in ascending order
+    std::vector<uint32_t> cellStart;
+    std::vector<int> cellTriangles;
+    uint64_t version;
+};
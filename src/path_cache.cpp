@@ -0,0 +1,89 @@
+#include "path_cache.hpp"
+
+#include <cmath>
+
+PathCache::PathCache(size_t capacity, double quantization) : capacity(capacity), quantization(quantization > 0 ? quantization : 1)
+{
+}
+
+bool PathCache::Key::operator==(const Key &other) const
+{
+    return startX == other.startX && startY == other.startY && targetX == other.targetX && targetY == other.targetY &&
+           navMeshVersion == other.navMeshVersion;
+}
+
+size_t PathCache::KeyHash::operator()(const Key &key) const
+{
+    // FNV-1a over the fields
+    uint64_t hash = 14695981039346656037ull;
+    for (uint64_t value : {uint64_t(key.startX), uint64_t(key.startY), uint64_t(key.targetX), uint64_t(key.targetY), key.navMeshVersion})
+    {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    }
+    return size_t(hash);
+}
+
+PathCache::Key PathCache::makeKey(jngl::Vec2 start, jngl::Vec2 target, uint64_t navMeshVersion) const
+{
+    return {int64_t(std::floor(start.x / quantization)), int64_t(std::floor(start.y / quantization)),
+            int64_t(std::floor(target.x / quantization)), int64_t(std::floor(target.y / quantization)), navMeshVersion};
+}
+
+bool PathCache::find(jngl::Vec2 start, jngl::Vec2 target, uint64_t navMeshVersion, std::deque<jngl::Vec2> &result)
+{
+    const Key key = makeKey(start, target, navMeshVersion);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end())
+    {
+        ++misses;
+        return false;
+    }
+    ++hits;
+    entries.splice(entries.begin(), entries, found->second);
+    result = found->second->second;
+    if (!result.empty())
+    {
+        result.front() = start;
+        result.back() = target;
+    }
+    return true;
+}
+
+void PathCache::insert(jngl::Vec2 start, jngl::Vec2 target, uint64_t navMeshVersion, const std::deque<jngl::Vec2> &path)
+{
+    if (capacity == 0)
+    {
+        return;
+    }
+    const Key key = makeKey(start, target, navMeshVersion);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found != index.end())
+    {
+        found->second->second = path;
+        entries.splice(entries.begin(), entries, found->second);
+        return;
+    }
+    if (entries.size() >= capacity)
+    {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(key, path);
+    index.emplace(key, entries.begin());
+}
+
+void PathCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+}
+
+size_t PathCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <jngl/Vec2.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+/// Least recently used cache of found paths.
+/// Start and target are rounded to a grid, so clicks next to each other share an entry.
+/// Thread safe.
+class PathCache
+{
+public:
+    /// quantization: size of the grid cells the endpoints are rounded to
+    PathCache(size_t capacity, double quantization);
+
+    /// Copies the cached path for the endpoints on the navmesh with the given version into result.
+    /// The first and the last point are replaced by start and target.
+    bool find(jngl::Vec2 start, jngl::Vec2 target, uint64_t navMeshVersion, std::deque<jngl::Vec2> &result);
+    void insert(jngl::Vec2 start, jngl::Vec2 target, uint64_t navMeshVersion, const std::deque<jngl::Vec2> &path);
+    /// Drops all entries, e.g. because the walkable area changed
+    void clear();
+
+    size_t getHits() const { return hits; }
+    size_t getMisses() const { return misses; }
+    size_t size() const;
+
+private:
+    struct Key
+    {
+        int64_t startX, startY, targetX, targetY;
+        uint64_t navMeshVersion;
+        bool operator==(const Key &other) const;
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+    using Entry = std::pair<Key, std::deque<jngl::Vec2>>;
+
+    Key makeKey(jngl::Vec2 start, jngl::Vec2 target, uint64_t navMeshVersion) const;
+
+    const size_t capacity;
+    const double quantization;
+    mutable std::mutex mutex;
+    /// Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+};
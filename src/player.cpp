@@ -11,6 +11,9 @@ Player::Player(std::shared_ptr<Game> game, const std::string &spine_file) : Spin
                                                                             NEAR_OBJECT(game->config["near_object"].as<int>()),
                                                                             X_BORDER(game->config["border"]["x"].as<int>()),
                                                                             Y_BORDER(game->config["border"]["y"].as<int>()),
+                                                                            FAR_SCALE(game->config["player_far_scale"].as<float>(1)),
+                                                                            NEAR_SCALE(game->config["player_near_scale"].as<float>(1)),
+                                                                            RADIUS(game->config["player_radius"].as<float>(30.0f)),
                                                                             max_speed(std::abs(game->config["player_max_speed"].as<float>())),
                                                                             player_walk_animation(game->config["player_walk_animation"].as<std::string>()),
                                                                             player_side_skin(game->config["player_side_skin"].as<std::string>()),
@@ -112,10 +115,8 @@ void Player::addTargetPositionImmediately(jngl::Vec2 target, sol::function callb
         path.clear();
         if (target != position)
         {
-            newPath = _game->currentScene->background->getPathToTarget(position, target);
-
-            path.insert(path.end(), newPath.begin(), newPath.end());
             this->walk_callback = callback;
+            requestPath(target);
         }else{
             this->walk_callback = callback;
             walk_callback();
@@ -124,8 +125,55 @@ void Player::addTargetPositionImmediately(jngl::Vec2 target, sol::function callb
     }
 }
 
+void Player::requestPath(jngl::Vec2 target)
+{
+    if (auto _game = game.lock())
+    {
+        const size_t request = ++pathRequest;
+        waitingForPath = true;
+
+        // Stand still until the path is there, but already turn around
+        path.clear();
+        path.push_back(position);
+        setTargentPosition(position);
+        if (_game->currentScene->background->is_walkable(target))
+        {
+            setDirection(target);
+        }
+
+        std::weak_ptr<SpineObject> weakPlayer = getptr();
+        _game->currentScene->background->requestPathToTarget(position, target, [weakPlayer, request](std::deque<jngl::Vec2> result)
+        {
+            auto player = std::static_pointer_cast<Player>(weakPlayer.lock());
+            if (!player || request != player->pathRequest)
+            {
+                return;
+            }
+            player->waitingForPath = false;
+            if (result.empty())
+            {
+                // Can't get there, don't report arriving
+                if (auto _game = player->game.lock())
+                {
+                    player->walk_callback = (*_game->lua_state)["pass"];
+                }
+                return;
+            }
+            player->path = std::move(result);
+            player->setTargentPosition(player->path.front());
+        });
+    }
+}
+
+void Player::cancelPathRequest()
+{
+    ++pathRequest;
+    waitingForPath = false;
+}
+
 void Player::stop_walking()
 {
+    cancelPathRequest();
     path.clear();
     setTargentPosition(position);
 }
@@ -141,10 +189,6 @@ bool Player::step(bool)
         }
 #endif
 
-        skeleton->step();
-        spSkeleton_updateWorldTransform(skeleton->skeleton);
-        spSkeletonBounds_update(bounds, skeleton->skeleton, true);
-
         if (_game->getDialogManager()->isActive())
             return false;
         if (_game->getInactivLayerBorder() > layer)
@@ -158,11 +202,14 @@ bool Player::step(bool)
         }
 
         jngl::Vec2 tmp_target_position = target_position - position;
-        if (tmp_target_position == jngl::Vec2(0, 0) && currentAnimation == player_walk_animation)
+        if (tmp_target_position == jngl::Vec2(0, 0) && currentAnimation == player_walk_animation && !waitingForPath)
         {
             currentAnimation = player_idle_animation;
             // Callback to Lua
-            walk_callback();
+            {
+                LuaProfiler::Scope scope(*_game->getLuaProfiler(), "walk callback", id);
+                walk_callback();
+            }
             walk_callback = (*_game->lua_state)["pass"];
 
             if(currentAnimation == player_idle_animation)
@@ -174,20 +221,25 @@ bool Player::step(bool)
             }
         }
 
+        // Far away from the camera the player is smaller and walks slower
+        const DepthMap *depthMap = _game->currentScene->getDepthMap();
+        perspectiveScale = depthMap ? FAR_SCALE + (NEAR_SCALE - FAR_SCALE) * depthMap->sample(position) : 1.f;
+        const double speed = max_speed * perspectiveScale;
+
         auto magnitude = std::sqrt(boost::qvm::dot(tmp_target_position, tmp_target_position));
-        if (magnitude != 0 && magnitude > max_speed)
+        if (magnitude != 0 && magnitude > speed)
         {
-            tmp_target_position *= max_speed / magnitude;
+            tmp_target_position *= speed / magnitude;
         }
         position += tmp_target_position;
 
-        // TODO it's still possible to walk outside of the nav mesh. We have to fix that soon.
-        //#ifndef NDEBUG
-        //   if (!_game->currentScene->background->is_walkable(position))
-        //   {
-        //       throw std::runtime_error("Player is in a not Walkable area!");
-        //   }
-        //#endif
+#ifndef NDEBUG
+        // Cheap thanks to the walk mask, so it can run every step
+        if (tmp_target_position != jngl::Vec2(0, 0) && !_game->currentScene->background->isInWalkableArea(position))
+        {
+            jngl::debugLn("Player left the walkable area at x: " + std::to_string(position.x) + " y: " + std::to_string(position.y));
+        }
+#endif
 
         if (_game->pointer->secondaryPressed())
         {
@@ -214,7 +266,8 @@ bool Player::step(bool)
         if (_game->pointer->primaryPressed() && interruptible && !_game->pointer->isPrimaryAlreadyHandled())
         {
             jngl::Vec2 click_position = _game->pointer->getPosition();
-            auto collision = spSkeletonBounds_containsPoint(bounds, (float)click_position.x - (float)position.x, (float)click_position.y - (float)position.y);
+            // The bounds aren't scaled, draw applies the perspective scale
+            auto collision = spSkeletonBounds_containsPoint(bounds, float((click_position.x - position.x) / perspectiveScale), float((click_position.y - position.y) / perspectiveScale));
             if (collision)
             {
                 collision_script = collision->super.super.name;
@@ -225,21 +278,15 @@ bool Player::step(bool)
 
             }
 
-            path.clear();
-            newPath = _game->currentScene->background->getPathToTarget(position, click_position);
             walk_callback = (*_game->lua_state)["pass"];
-
-            path.insert(path.end(), newPath.begin(), newPath.end());
-            if (path.size() > 0)
-            {
-                setTargentPosition(path.front());
-            }
+            requestPath(click_position);
 
             // Handle double click
             double time = jngl::getTime();
             auto click_distance = boost::qvm::dot(last_click_position - click_position, last_click_position - click_position);
             if (max_speed > 0.0 && _game->currentScene->background->is_walkable(click_position) && time - last_click_time < DOUBLE_CLICK_TIME && click_distance < MAX_CLICK_DISTANCE)
             {
+                cancelPathRequest();
                 path.clear();
                 walk_callback = (*_game->lua_state)["pass"];
                 path.push_back(click_position);
@@ -263,11 +310,17 @@ bool Player::step(bool)
     return false;
 }
 
+bool Player::isWalking() const
+{
+    return waitingForPath || position != target_position || path.size() > 1;
+}
+
 void Player::draw() const
 {
     jngl::pushMatrix();
     jngl::translate(position);
     jngl::rotate(getRotation());
+    jngl::scale(perspectiveScale);
 
 #ifndef NDEBUG
     if (auto _game = game.lock())
@@ -21,10 +21,12 @@ public:
     void addTargetPosition(jngl::Vec2 target);
     void addTargetPositionImmediately(jngl::Vec2 target, sol::function callback);
     void stop_walking();
+    bool isWalking() const override;
 
     double last_click_time = 0;
 
     float getMaxSpeed(){return max_speed;};
+    float getRadius() const { return RADIUS; }
     void setMaxSpeed(float speed){max_speed = speed;};
     jngl::Vec2 calcCamPos();
 
@@ -36,7 +38,13 @@ private:
     const int NEAR_OBJECT;
     const int X_BORDER;
     const int Y_BORDER;
+    /// Scale of the player at the darkest and brightest spots of the zBufferMap
+    const float FAR_SCALE;
+    const float NEAR_SCALE;
+    /// NavCrowd agents keep this far away from the player
+    const float RADIUS;
     float max_speed;
+    float perspectiveScale = 1;
     std::deque<jngl::Vec2> path;
     jngl::Vec2 target_position = jngl::Vec2(0, 0);
     void setTargentPosition(jngl::Vec2 position);
@@ -50,5 +58,11 @@ private:
 
     void setDirection(jngl::Vec2 target_position);
 
-    std::deque<jngl::Vec2> newPath;
+    /// Turns towards target and walks there as soon as the path has been found on a worker
+    void requestPath(jngl::Vec2 target);
+    /// Drops the result of a running path request
+    void cancelPathRequest();
+    /// Incremented with every path request, results of older requests are ignored
+    size_t pathRequest = 0;
+    bool waitingForPath = false;
 };
@@ -29,13 +29,13 @@ Scene::Scene(const std::string &fileName, std::shared_ptr<Game> game) : json(YAM
 
     // Get old scene and set game.scene to current
     if (!(*game->lua_state)["game"].valid())
-		(*game->lua_state).script("game = {}");
+		(*game->lua_state)["game"] = game->lua_state->create_table();
 	std::string old_scene = "";
 	if ((*game->lua_state)["game"]["scene"].valid())
     {
        	old_scene = (*game->lua_state)["game"]["scene"];
     }
-	(*game->lua_state).script("game.scene = '" + fileName + "'");
+	(*game->lua_state)["game"]["scene"] = fileName;
 
 
     if (!(*game->lua_state)["scenes"].valid())
@@ -117,7 +117,7 @@ Scene::Scene(const std::string &fileName, std::shared_ptr<Game> game) : json(YAM
 
     if (json["zBufferMap"].IsDefined() && !json["zBufferMap"].IsNull())
     {
-        this->zBufferMap = std::make_unique<jngl::Sprite>(jngl::Sprite(json["zBufferMap"].as<std::string>()));
+        this->zBufferMap = std::make_unique<DepthMap>(json["zBufferMap"].as<std::string>(), game->config["zbuffer_map_cell_size"].as<int>(8));
     }
 
     if (json["backgroundMusic"].IsDefined() && !json["backgroundMusic"].IsNull())
@@ -140,12 +140,14 @@ Scene::Scene(const std::string &fileName, std::shared_ptr<Game> game) : json(YAM
     }
 
     // Move cross_scene object's LUA from old to new scene
+    sol::optional<sol::table> oldItems = (*game->lua_state)["scenes"][old_scene]["items"];
+    sol::optional<sol::table> items = (*game->lua_state)["scenes"][scene]["items"];
     for (auto it = game->gameObjects.begin(); it != game->gameObjects.end();)
 	{
-		if ((*it)->cross_scene && (*game->lua_state)["scenes"][old_scene]["items"][(*it)->getId()].valid())
+		if ((*it)->cross_scene && oldItems && items && (*oldItems)[(*it)->getId()].valid())
 		{
-            (*game->lua_state).script("scenes[game.scene].items." + (*it)->getId() + " = " + "scenes[\"" + old_scene + "\"].items." + (*it)->getId());
-            (*game->lua_state).script("scenes[\"" + old_scene + "\"].items." + (*it)->getId() + " = nil");
+            (*items)[(*it)->getId()] = (*oldItems)[(*it)->getId()];
+            (*oldItems)[(*it)->getId()] = sol::lua_nil;
 		}
         ++it;
     }
@@ -320,6 +322,8 @@ void Scene::loadObjects(YAML::Node objects)
                     "layer", layer,
                     "scale", scale);
 
+                interactable->setLuaTable((*_game->lua_state)["scenes"][scene]["items"][object_id]);
+
                 if ((*object)["skin"])
                 {
                     std::string skin = (*object)["skin"].as<std::string>();
@@ -373,6 +377,7 @@ void Scene::loadObjects(YAML::Node objects)
                     }
 
                     (*_game->lua_state)["scenes"][scene]["items"][id]["object"] = std::static_pointer_cast<SpineObject>(interactable);
+                    interactable->setLuaTable(value.as<sol::table>());
 
                     if ((*_game->lua_state)["scenes"][scene]["items"][id]["skin"].valid() )
                     {
@@ -3,6 +3,7 @@
 #include <jngl.hpp>
 #include <yaml-cpp/yaml.h>
 #include "background.hpp"
+#include "depth_map.hpp"
 
 class Game;
 class InteractableObject;
@@ -28,6 +29,8 @@ public:
     void loadObjects(YAML::Node objects);
 
     std::string getSceneName(){return fileName;};
+    /// Depth of the scene from its zBufferMap, nullptr if it has none
+    const DepthMap *getDepthMap() const { return zBufferMap.get(); };
 
     std::shared_ptr<Background> background;
     int left_border = INT_MIN;
@@ -39,7 +42,7 @@ private:
     YAML::Node json;
 
     std::optional<std::string> backgroundMusic;
-    std::unique_ptr<jngl::Sprite> zBufferMap;
+    std::unique_ptr<DepthMap> zBufferMap;
 
     const std::weak_ptr<Game> game;
 };
@@ -0,0 +1,116 @@
+#include "script_scheduler.hpp"
+
+#include <iostream>
+
+void ScriptScheduler::run(sol::state &lua, const sol::protected_function &func, sol::object thisObject,
+                          const std::string &errorMessage)
+{
+    globals = lua.globals();
+    uint32_t slot;
+    if (freeSlots.empty())
+    {
+        slot = uint32_t(tasks.size());
+        tasks.emplace_back();
+    }
+    else
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    auto task = std::make_unique<Task>();
+    task->thread = sol::thread::create(lua.lua_state());
+    task->coroutine = sol::coroutine(task->thread.thread_state(), sol::ref_index(func.registry_index()));
+    task->errorMessage = errorMessage;
+    task->thisObject = std::move(thisObject);
+    tasks[slot] = std::move(task);
+    resume(slot);
+}
+
+bool ScriptScheduler::wait(lua_State *thread, int frames, std::function<bool()> condition)
+{
+    for (auto &task : tasks)
+    {
+        if (task && task->running && task->thread.thread_state() == thread)
+        {
+            task->frames = frames;
+            task->condition = std::move(condition);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ScriptScheduler::step()
+{
+    ready.clear();
+    for (uint32_t slot = 0; slot < tasks.size(); ++slot)
+    {
+        Task *task = tasks[slot].get();
+        if (!task || task->running)
+        {
+            continue;
+        }
+        if (task->frames > 0)
+        {
+            --task->frames;
+        }
+        if (task->frames == 0 && (!task->condition || task->condition()))
+        {
+            ready.push_back(slot);
+        }
+    }
+    for (uint32_t slot : ready)
+    {
+        resume(slot);
+    }
+}
+
+void ScriptScheduler::clear()
+{
+    for (uint32_t slot = 0; slot < tasks.size(); ++slot)
+    {
+        if (tasks[slot] && !tasks[slot]->running)
+        {
+            tasks[slot].reset();
+            freeSlots.push_back(slot);
+        }
+    }
+}
+
+void ScriptScheduler::resume(uint32_t slot)
+{
+    // A script that yields without one of the Wait functions continues in the next step
+    Task *task = tasks[slot].get();
+    task->frames = 0;
+    task->condition = nullptr;
+    task->running = true;
+    // A script started by another script restores the this of the outer one afterwards.
+    // Otherwise this stays set, like after a callback or an action that didn't wait.
+    sol::object previousThis;
+    if (nesting > 0)
+    {
+        previousThis = globals["this"];
+    }
+    globals["this"] = task->thisObject;
+    ++nesting;
+    auto result = task->coroutine();
+    --nesting;
+    if (nesting > 0)
+    {
+        globals["this"] = previousThis;
+    }
+    task->running = false;
+
+    if (!result.valid())
+    {
+        sol::error err = result;
+        std::cerr << task->errorMessage << err.what() << std::endl;
+        ++failed;
+    }
+    else if (result.status() == sol::call_status::yielded)
+    {
+        return;
+    }
+    tasks[slot].reset();
+    freeSlots.push_back(slot);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <sol/sol.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Runs Lua scripts as coroutines, so that they can wait for the game with
+/// WaitFrames, WaitForWalk and WaitForAnimation instead of nesting callbacks.
+/// Waiting scripts are checked once per step and the ready ones are resumed in the order
+/// they were started.
+class ScriptScheduler
+{
+public:
+    /// Runs func until it returns or waits for the first time.
+    /// The global this is set to thisObject every time the coroutine is resumed.
+    void run(sol::state &lua, const sol::protected_function &func, sol::object thisObject, const std::string &errorMessage);
+
+    /// Lets the coroutine running on thread wait for frames steps and until condition is true.
+    /// Called from a Lua function right before it yields. Returns false if thread isn't one of
+    /// the scheduler's coroutines, e.g. in a callback.
+    bool wait(lua_State *thread, int frames, std::function<bool()> condition);
+
+    /// Resumes the coroutines that are done waiting. Main thread only.
+    void step();
+    /// Drops all coroutines, e.g. when a savegame is loaded
+    void clear();
+    /// Number of coroutines waiting
+    size_t size() const { return tasks.size() - freeSlots.size(); }
+    /// Number of coroutines that stopped with a runtime error so far
+    size_t getFailed() const { return failed; }
+
+private:
+    struct Task
+    {
+        sol::thread thread;
+        sol::coroutine coroutine;
+        std::string errorMessage;
+        /// Other scripts may have changed the global this while the coroutine was waiting
+        sol::object thisObject;
+        int frames = 0;
+        std::function<bool()> condition;
+        /// Set while the coroutine is executing, e.g. if it started another script
+        bool running = false;
+    };
+
+    void resume(uint32_t slot);
+
+    /// Globals of the main Lua state
+    sol::table globals;
+    /// Coroutines currently executing, more than one if a script started another script
+    int nesting = 0;
+    size_t failed = 0;
+
+    /// Tasks don't move when the vector grows, scripts can start scripts while they run
+    std::vector<std::unique_ptr<Task>> tasks;
+    std::vector<uint32_t> freeSlots;
+    /// Reused every step
+    std::vector<uint32_t> ready;
+};
@@ -1,6 +1,9 @@
 #include "skeleton_drawable.hpp"
 #include "game.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #ifndef SPINE_MESH_VERTEX_COUNT_MAX
 #define SPINE_MESH_VERTEX_COUNT_MAX 1000
 #endif
@@ -46,7 +49,8 @@ char* _spUtil_readFile(const char* path, int* length) {
 	if (length) {
 		*length = static_cast<int>(str.length());
 	}
-	char* buf = static_cast<char*>(malloc(str.length() + 1));
+	// spine-c releases the buffer with FREE, which goes to the spine allocator
+	char* buf = MALLOC(char, str.length() + 1);
 	std::copy(str.begin(), str.end(), buf);
 	buf[str.length()] = '\0';
 	return buf;
@@ -82,12 +86,96 @@ SkeletonDrawable::~SkeletonDrawable() {
 }
 
 void SkeletonDrawable::step() {
-	const float deltaTime = 1.f / float(jngl::getStepsPerSecond());
+	update(1.f / float(jngl::getStepsPerSecond()));
+}
+
+void SkeletonDrawable::update(const float deltaTime) {
 	spAnimationState_update(state, deltaTime * timeScale);
 	spAnimationState_apply(state, skeleton);
 	spSkeleton_updateWorldTransform(skeleton);
 }
 
+void SkeletonDrawable::advance(const float deltaTime) {
+	spAnimationState_update(state, deltaTime * timeScale);
+	for (int i = 0; i < state->tracksCount; ++i) {
+		spTrackEntry* entry = state->tracks[i];
+		if (!entry || entry->delay > 0) continue;
+		if (entry->mixingFrom) fireMixingFromEvents(entry);
+		// A reversed animation fires no events, only its completion
+		fireEvents(entry, !entry->reverse, true);
+	}
+}
+
+// The event handling below mirrors _spAnimationState_apply, _spAnimationState_applyMixingFrom
+// and _spAnimationState_queueEvents of spine-c 4.1 (spine-c/src/spine/AnimationState.c), without
+// applying any other timeline. Compare it with those again when updating spine-runtimes,
+// skeleton_advance_events_test checks that both paths fire the same events.
+void SkeletonDrawable::fireMixingFromEvents(spTrackEntry* to) {
+	spTrackEntry* from = to->mixingFrom;
+	if (from->mixingFrom) fireMixingFromEvents(from);
+	float mix = 1;
+	if (to->mixDuration != 0) mix = std::min(1.f, to->mixTime / to->mixDuration);
+	fireEvents(from, mix < from->eventThreshold, to->mixDuration > 0);
+}
+
+void SkeletonDrawable::fireEvents(spTrackEntry* entry, const bool timelineEvents, const bool queue) {
+	const float animationStart = entry->animationStart;
+	const float animationEnd = entry->animationEnd;
+	const float duration = animationEnd - animationStart;
+	const float animationTime = spTrackEntry_getAnimationTime(entry);
+	float lastTime = entry->animationLast;
+	float time = animationTime;
+	if (entry->loop && entry->animation->duration != 0) {
+		time = std::fmod(time, entry->animation->duration);
+		if (lastTime > 0) lastTime = std::fmod(lastTime, entry->animation->duration);
+	}
+
+	int eventsCount = 0;
+	spTimelineArray* timelines = entry->animation->timelines;
+	for (int i = 0; timelineEvents && i < timelines->size; ++i) {
+		spTimeline* timeline = timelines->items[i];
+		if (timeline->type != SP_TIMELINE_EVENT) continue;
+		// A looping animation can wrap around once, so every key can fire at most twice
+		firedEvents.resize(eventsCount + 2 * timeline->frames->size);
+		spTimeline_apply(timeline, skeleton, lastTime, time, firedEvents.data(), &eventsCount, 1,
+		                 SP_MIX_BLEND_REPLACE, SP_MIX_DIRECTION_IN);
+	}
+
+	if (queue) {
+		const float trackLastWrapped = duration == 0 ? 0 : std::fmod(entry->trackLast, duration);
+		int i = 0;
+		for (; i < eventsCount; ++i) {
+			spEvent* event = firedEvents[i];
+			if (event->time < trackLastWrapped) break;
+			if (event->time > animationEnd) continue;
+			if (state->listener) state->listener(state, SP_ANIMATION_EVENT, entry, event);
+		}
+
+		bool complete;
+		if (entry->loop) {
+			if (duration == 0) {
+				complete = true;
+			} else {
+				const int cycles = static_cast<int>(entry->trackTime / duration);
+				complete = cycles > 0 && cycles > static_cast<int>(entry->trackLast / duration);
+			}
+		} else {
+			complete = animationTime >= animationEnd && entry->animationLast < animationEnd;
+		}
+		if (complete && state->listener) state->listener(state, SP_ANIMATION_COMPLETE, entry, nullptr);
+
+		for (; i < eventsCount; ++i) {
+			spEvent* event = firedEvents[i];
+			if (event->time < animationStart) continue;
+			if (state->listener) state->listener(state, SP_ANIMATION_EVENT, entry, event);
+		}
+	}
+
+	// Normally done by spAnimationState_apply, keeps the events from firing again
+	entry->nextAnimationLast = animationTime;
+	entry->nextTrackLast = entry->trackTime;
+}
+
 void SkeletonDrawable::endAnimation(int trackIndex)
 {
 	auto animation = spAnimationState_getCurrent(state, trackIndex);
@@ -179,7 +267,7 @@ void SkeletonDrawable::draw() const {
 		 	static_cast<uint8_t>(skeleton->color.a * slot->color.a * attachmentColor->a * 255);
 
 
-			std::vector<jngl::Vertex> vertexArray;
+			vertexArray.clear();
 			for (int i = 0; i < indicesCount; ++i) {
 				int index = indices[i] << 1;
 				vertexArray.push_back(jngl::Vertex{
@@ -227,4 +315,18 @@ spBoundingBoxAttachment *spSkeletonBounds_containsPointNotMatchingName(spSkeleto
 	return 0;
 }
 
+bool isInteractableBoundingBox(const std::string &name) {
+	return name != "walkable_area" && name != "walkable_hole" && name != "blocking_area";
+}
+
+spBoundingBoxAttachment *spSkeletonBounds_containsInteractablePoint(spSkeletonBounds *self, float x, float y) {
+	int i;
+	for (i = 0; i < self->count; ++i)
+	{
+		if (isInteractableBoundingBox(self->boundingBoxes[i]->super.super.name))
+			if (spPolygon_containsPoint(self->polygons[i], x, y)) return self->boundingBoxes[i];
+	}
+	return 0;
+}
+
 } // namespace spine
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <jngl.hpp>
+#include <vector>
 
 #include <spine/spine.h>
 #include <spine/extension.h>
@@ -22,6 +23,14 @@ public:
 
 	void step() override;
 
+	/// Advances the animation state by deltaTime seconds and poses the skeleton.
+	/// Doesn't touch anything outside of this skeleton, so it's safe to call from a worker thread.
+	void update(float deltaTime);
+
+	/// Like update, but only advances the animation time and fires Spine events and
+	/// completions without posing the skeleton. The next update catches the pose up.
+	void advance(float deltaTime);
+
 	void draw() const override;
 
 #ifndef NDEBUG
@@ -34,10 +43,23 @@ private:
 	spFloatArray* tempUvs;
 	spColorArray* tempColors;
 	spSkeletonClipping* clipper;
+	/// Reused by draw so that drawing doesn't allocate once the buffer is big enough
+	mutable std::vector<jngl::Vertex> vertexArray;
+	/// Reused buffer for the events fired by advance
+	std::vector<spEvent*> firedEvents;
+
+	/// Fires the events of the entries to is mixing from, like spAnimationState_apply would
+	void fireMixingFromEvents(spTrackEntry* to);
+	/// timelineEvents: collect the keys of the event timelines, queue: report events and completion
+	void fireEvents(spTrackEntry* entry, bool timelineEvents, bool queue);
 };
 
 
 spBoundingBoxAttachment *spSkeletonBounds_containsPointMatchingName(spSkeletonBounds *self, const std::string &name, float x, float y);
 spBoundingBoxAttachment *spSkeletonBounds_containsPointNotMatchingName(spSkeletonBounds *self, const std::string &name, float x, float y);
+/// False for the bounding boxes used for walking (walkable_area, walkable_hole, blocking_area)
+bool isInteractableBoundingBox(const std::string &name);
+/// Bounding box at x, y that isn't used for walking
+spBoundingBoxAttachment *spSkeletonBounds_containsInteractablePoint(spSkeletonBounds *self, float x, float y);
 
 } // namespace spine
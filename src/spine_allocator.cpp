@@ -0,0 +1,167 @@
+#include "spine_allocator.hpp"
+
+#include <spine/extension.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+namespace
+{
+    /// Stored in front of every block, keeps the payload aligned like malloc does
+    struct alignas(16) BlockHeader
+    {
+        uint32_t sizeClass;
+        /// Requested size, needed for realloc
+        size_t size;
+    };
+
+    constexpr std::array<size_t, 12> SIZE_CLASSES = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024};
+    constexpr uint32_t LARGE = UINT32_MAX;
+    constexpr size_t SLAB_SIZE = 64 * 1024;
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    struct Pool
+    {
+        std::mutex mutex;
+        FreeBlock *freeList = nullptr;
+        size_t cached = 0;
+    };
+
+    std::array<Pool, SIZE_CLASSES.size()> pools;
+    std::atomic<size_t> liveBlocks{0};
+    std::atomic<size_t> reservedBytes{0};
+    std::atomic<size_t> largeAllocations{0};
+
+    uint32_t findSizeClass(size_t size)
+    {
+        const auto it = std::lower_bound(SIZE_CLASSES.begin(), SIZE_CLASSES.end(), size);
+        return it == SIZE_CLASSES.end() ? LARGE : uint32_t(it - SIZE_CLASSES.begin());
+    }
+
+    /// Fills the free list of the pool with a new slab. The pool's mutex has to be locked.
+    bool refill(Pool &pool, uint32_t sizeClass)
+    {
+        const size_t blockSize = sizeof(BlockHeader) + SIZE_CLASSES[sizeClass];
+        const size_t count = std::max<size_t>(SLAB_SIZE / blockSize, 1);
+        // Slabs are never returned, the memory gets reused by the next scene
+        auto slab = static_cast<char *>(std::malloc(blockSize * count));
+        if (!slab)
+        {
+            return false;
+        }
+        reservedBytes += blockSize * count;
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto block = reinterpret_cast<FreeBlock *>(slab + i * blockSize + sizeof(BlockHeader));
+            block->next = pool.freeList;
+            pool.freeList = block;
+        }
+        pool.cached += count;
+        return true;
+    }
+
+    void *spineMalloc(size_t size)
+    {
+        const uint32_t sizeClass = findSizeClass(size);
+        BlockHeader *header;
+        if (sizeClass == LARGE)
+        {
+            header = static_cast<BlockHeader *>(std::malloc(sizeof(BlockHeader) + size));
+            if (!header)
+            {
+                return nullptr;
+            }
+            ++largeAllocations;
+        }
+        else
+        {
+            Pool &pool = pools[sizeClass];
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (!pool.freeList && !refill(pool, sizeClass))
+            {
+                return nullptr;
+            }
+            FreeBlock *block = pool.freeList;
+            pool.freeList = block->next;
+            --pool.cached;
+            header = reinterpret_cast<BlockHeader *>(reinterpret_cast<char *>(block) - sizeof(BlockHeader));
+        }
+        header->sizeClass = sizeClass;
+        header->size = size;
+        ++liveBlocks;
+        return header + 1;
+    }
+
+    void spineFree(void *ptr)
+    {
+        if (!ptr)
+        {
+            return;
+        }
+        BlockHeader *header = static_cast<BlockHeader *>(ptr) - 1;
+        --liveBlocks;
+        if (header->sizeClass == LARGE)
+        {
+            --largeAllocations;
+            std::free(header);
+            return;
+        }
+        Pool &pool = pools[header->sizeClass];
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        auto block = static_cast<FreeBlock *>(ptr);
+        block->next = pool.freeList;
+        pool.freeList = block;
+        ++pool.cached;
+    }
+
+    void *spineRealloc(void *ptr, size_t size)
+    {
+        if (!ptr)
+        {
+            return spineMalloc(size);
+        }
+        BlockHeader *header = static_cast<BlockHeader *>(ptr) - 1;
+        if (header->sizeClass != LARGE && size <= SIZE_CLASSES[header->sizeClass])
+        {
+            header->size = size;
+            return ptr;
+        }
+        void *result = spineMalloc(size);
+        if (result)
+        {
+            std::memcpy(result, ptr, std::min(size, header->size));
+            spineFree(ptr);
+        }
+        return result;
+    }
+} // namespace
+
+void installSpineAllocator()
+{
+    _spSetMalloc(&spineMalloc);
+    _spSetRealloc(&spineRealloc);
+    _spSetFree(&spineFree);
+}
+
+SpineAllocatorStats getSpineAllocatorStats()
+{
+    SpineAllocatorStats stats;
+    stats.liveBlocks = liveBlocks;
+    stats.reservedBytes = reservedBytes;
+    stats.largeAllocations = largeAllocations;
+    for (auto &pool : pools)
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        stats.cachedBlocks += pool.cached;
+    }
+    return stats;
+}
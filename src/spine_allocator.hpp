@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+/// Statistics of the pools behind spine-c's allocations
+struct SpineAllocatorStats
+{
+    /// Blocks currently handed out to spine-c
+    size_t liveBlocks = 0;
+    /// Freed blocks waiting in the pools to be reused
+    size_t cachedBlocks = 0;
+    /// Memory taken from the system for the pools
+    size_t reservedBytes = 0;
+    /// Allocations too big for the pools, they go straight to malloc
+    size_t largeAllocations = 0;
+};
+
+/// Routes spine-c's MALLOC, CALLOC, REALLOC and FREE through size class pools, so that
+/// track entries and the other small Spine objects are recycled instead of fragmenting the
+/// heap. Must be called before the first Spine object is created. Thread safe.
+void installSpineAllocator();
+
+SpineAllocatorStats getSpineAllocatorStats();
@@ -1,56 +1,136 @@
 #include "spine_object.hpp"
+#include "depth_map.hpp"
 #include "game.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <sstream>
+
 void SpineObject::animationStateListener(spAnimationState *state, spEventType type, spTrackEntry *entry,
                                                spEvent *event)
 {
-    if (event)
+    if (!event && type != SP_ANIMATION_COMPLETE && (type != SP_ANIMATION_DISPOSE || !entry->userData))
+    {
+        return;
+    }
+
+    auto obj = reinterpret_cast<SpineObject *>(state->userData);
+    // The entry may be disposed before the event is replayed, only its slot is kept
+    const int callbackSlot = int(reinterpret_cast<intptr_t>(entry->userData)) - 1;
+    const unsigned int callbackGeneration = callbackSlot >= 0 ? obj->animationCallbacks[callbackSlot].generation : 0;
+    const QueuedAnimationEvent queued{type, entry->trackIndex, bool(entry->loop), entry->animation,
+                                      event ? event->data : nullptr, callbackSlot, callbackGeneration};
+    if (obj->queueAnimationEvents)
+    {
+        obj->queuedAnimationEvents.push_back(queued);
+        return;
+    }
+    obj->handleAnimationEvent(queued);
+}
+
+void SpineObject::handleAnimationEvent(const QueuedAnimationEvent &event)
+{
+    if (event.eventData)
     {
-        if (event->data->audioPath)
+        if (event.eventData->audioPath)
         {
-            jngl::debugLn(event->data->audioPath);
-            jngl::play("audio/" + std::string(event->data->audioPath));
+            jngl::debugLn(event.eventData->audioPath);
+            jngl::play("audio/" + std::string(event.eventData->audioPath));
         }
-        if (event->data->stringValue)
+        if (event.eventData->stringValue)
         {
-            // This in Lua setzen
+            jngl::debugLn(event.eventData->stringValue);
 
-            jngl::debugLn(event->data->stringValue);
-
-            if (auto _game = reinterpret_cast<SpineObject *>(state->userData)->game.lock())
+            auto script = eventScripts.find(event.eventData);
+            auto _game = game.lock();
+            if (script != eventScripts.end() && _game)
             {
-
-                (*_game->lua_state)["this"] = reinterpret_cast<SpineObject *>(state->userData)->getptr();
-                std::string extension = ".lua";
-                std::string event_string = std::string(event->data->stringValue);
-                if (std::equal(extension.rbegin(), extension.rend(), event_string.rbegin())) {
-                    // run lua script from file
+                (*_game->lua_state)["this"] = getptr();
+                // Objects can outlive the scene their scripts were compiled in
+                if (_game->getSceneEnvironment().valid())
+                {
+                    sol::set_environment(_game->getSceneEnvironment(), script->second);
                 }
-                else
+                std::optional<LuaProfiler::Scope> scope;
+                if (_game->getLuaProfiler()->isEnabled())
                 {
-                    _game->lua_state->script(event_string);
+                    scope.emplace(*_game->getLuaProfiler(), "event", id + " " + event.eventData->name);
+                }
+                sol::protected_function_result result = script->second();
+                if (!result.valid())
+                {
+                    sol::error err = result;
+                    std::cerr << "The LUA code of event " << event.eventData->name << " has failed to run!\n"
+                              << err.what() << std::endl;
                 }
             }
-            //if (event_string.ends_with(".lua"))
         }
     }
 
-    switch (type)
+    switch (event.type)
     {
     case SP_ANIMATION_INTERRUPT:
         break;
 
     case SP_ANIMATION_COMPLETE:
-        if (!entry->loop)
+        if (!event.loop)
         {
-            reinterpret_cast<SpineObject *>(state->userData)->onAnimationComplete(std::to_string(entry->trackIndex) + std::string(entry->animation->name));
+            onAnimationComplete(event.animation, event.callbackSlot, event.callbackGeneration);
         }
         break;
+    case SP_ANIMATION_DISPOSE:
+        releaseAnimationCallback(event.callbackSlot);
+        break;
     default:
         break;
     }
 }
 
+void SpineObject::updateAnimation(float deltaTime, AnimationDetail detail)
+{
+    queueAnimationEvents = true;
+    // The bounds decide whether an object is in view, they mustn't stay stale forever
+    if (detail == AnimationDetail::EventsOnly && ++stepsWithoutBounds >= BOUNDS_REFRESH_STEPS)
+    {
+        detail = AnimationDetail::Full;
+    }
+    switch (detail)
+    {
+    case AnimationDetail::HalfRate:
+        if (skippedAnimationTime == 0)
+        {
+            skippedAnimationTime = deltaTime;
+            break;
+        }
+        [[fallthrough]];
+    case AnimationDetail::Full:
+        skeleton->update(skippedAnimationTime + deltaTime);
+        skippedAnimationTime = 0;
+        spSkeletonBounds_update(bounds, skeleton->skeleton, true);
+        stepsWithoutBounds = 0;
+        break;
+    case AnimationDetail::EventsOnly:
+        // The bounds are refreshed every BOUNDS_REFRESH_STEPS steps
+        skeleton->advance(skippedAnimationTime + deltaTime);
+        skippedAnimationTime = 0;
+        break;
+    }
+    queueAnimationEvents = false;
+}
+
+void SpineObject::dispatchQueuedEvents()
+{
+    // Callbacks may queue new animations on this object, those fire their events immediately
+    for (size_t i = 0; i < queuedAnimationEvents.size(); ++i)
+    {
+        handleAnimationEvent(queuedAnimationEvents[i]);
+    }
+    queuedAnimationEvents.clear();
+}
+
 SpineObject::SpineObject(std::shared_ptr<Game> game, const std::string &spine_file, const std::string &id, float scale) : walk_callback((*game->lua_state)["pass"]), spine_name(spine_file), id(id), game(game)
 {
     atlas = spAtlas_createFromFile((spine_file + "/" + spine_file + ".atlas").c_str(), nullptr);
@@ -79,6 +159,7 @@ SpineObject::SpineObject(std::shared_ptr<Game> game, const std::string &spine_fi
     }
 
     spSkeletonJson_dispose(json);
+    compileEventScripts(*game->lua_state);
 
     animationStateData = spAnimationStateData_create(skeletonData);
     skeleton = std::make_unique<spine::SkeletonDrawable>(skeletonData, animationStateData);
@@ -90,6 +171,43 @@ SpineObject::SpineObject(std::shared_ptr<Game> game, const std::string &spine_fi
     skeleton->step();
 }
 
+void SpineObject::compileEventScripts(sol::state &lua)
+{
+    const std::string extension = ".lua";
+    for (int i = 0; i < skeletonData->eventsCount; ++i)
+    {
+        const spEventData *eventData = skeletonData->events[i];
+        if (!eventData->stringValue)
+        {
+            continue;
+        }
+        std::string script = eventData->stringValue;
+        std::string chunkName = spine_name + ": " + eventData->name;
+        if (script.size() > extension.size() && std::equal(extension.rbegin(), extension.rend(), script.rbegin()))
+        {
+            // Name of a Lua file instead of the code
+            chunkName = "scripts/" + script;
+            std::stringstream scriptstream = jngl::readAsset(chunkName);
+            if (!scriptstream)
+            {
+                jngl::debugLn("Can not load lua script " + chunkName);
+                continue;
+            }
+            script = scriptstream.str();
+        }
+
+        sol::load_result chunk = lua.load(script, chunkName);
+        if (!chunk.valid())
+        {
+            sol::error err = chunk;
+            std::cerr << "The LUA code of event " << eventData->name << " in " << spine_name << " doesn't compile!\n"
+                      << err.what() << std::endl;
+            continue;
+        }
+        eventScripts.emplace(eventData, chunk.get<sol::protected_function>());
+    }
+}
+
 std::optional<jngl::Vec2> SpineObject::getPoint(const std::string &point_name)
 {
     auto slot = spSkeleton_findSlot(skeleton->skeleton, point_name.c_str());
@@ -128,12 +246,11 @@ std::vector<std::string> SpineObject::getPointNames()
 
 void SpineObject::playAnimation(int trackIndex, const std::string &currentAnimation, bool loop, sol::function callback)
 {
-    this->animation_callback[std::to_string(trackIndex) + currentAnimation] = callback;
     this->currentAnimation = currentAnimation;
     spAnimation* animation = spSkeletonData_findAnimation(skeleton->state->data->skeletonData, currentAnimation.c_str());
     if (animation)
     {
-        spAnimationState_setAnimation(skeleton->state, trackIndex, animation, loop);
+        setAnimationCallback(spAnimationState_setAnimation(skeleton->state, trackIndex, animation, loop), std::move(callback));
     }
     else
     {
@@ -143,12 +260,11 @@ void SpineObject::playAnimation(int trackIndex, const std::string &currentAnimat
 
 void SpineObject::addAnimation(int trackIndex, const std::string& currentAnimation, bool loop, float delay, sol::function callback)
 {
-    this->animation_callback[std::to_string(trackIndex) + currentAnimation] = callback;
     this->currentAnimation = currentAnimation;
     spAnimation* animation = spSkeletonData_findAnimation(skeleton->state->data->skeletonData, currentAnimation.c_str());
     if (animation)
     {
-        spAnimationState_addAnimation(skeleton->state, trackIndex, animation, loop, delay);
+        setAnimationCallback(spAnimationState_addAnimation(skeleton->state, trackIndex, animation, loop, delay), std::move(callback));
     }
     else
     {
@@ -156,20 +272,57 @@ void SpineObject::addAnimation(int trackIndex, const std::string& currentAnimati
     }
 }
 
-void SpineObject::onAnimationComplete(std::string key)
+void SpineObject::setAnimationCallback(spTrackEntry *entry, sol::function callback)
+{
+    int slot;
+    if (freeAnimationCallbacks.empty())
+    {
+        slot = int(animationCallbacks.size());
+        animationCallbacks.emplace_back();
+    }
+    else
+    {
+        slot = freeAnimationCallbacks.back();
+        freeAnimationCallbacks.pop_back();
+    }
+    animationCallbacks[slot].callback = std::move(callback);
+    entry->userData = reinterpret_cast<void *>(intptr_t(slot + 1));
+}
+
+void SpineObject::releaseAnimationCallback(int slot)
+{
+    if (slot < 0)
+    {
+        return;
+    }
+    animationCallbacks[slot].callback = sol::function();
+    ++animationCallbacks[slot].generation;
+    freeAnimationCallbacks.push_back(slot);
+}
+
+void SpineObject::onAnimationComplete(spAnimation *animation, int callbackSlot, unsigned int callbackGeneration)
 {
     if (auto _game = game.lock())
     {
         if (nextAnimation.empty())
         {
             // Set animation back to default animation in LUA state
-            std::string lua_object = _game->getLUAPath(getId());
-            (*_game->lua_state).script(lua_object + ".animation = \"" + _game->config["spine_default_animation"].as<std::string>() + "\"");
-            (*_game->lua_state).script(lua_object + ".loop_animation = true");
+            saveAnimation(_game->config["spine_default_animation"].as<std::string>(), true);
         }
 
-        animation_callback[key]();
-        animation_callback[key] = (*_game->lua_state)["pass"];
+        if (callbackSlot >= 0 && animationCallbacks[callbackSlot].generation == callbackGeneration &&
+            animationCallbacks[callbackSlot].callback.valid())
+        {
+            // Called only once. The callback may start animations, which can dispose the entry and reuse its slot.
+            sol::function callback = std::move(animationCallbacks[callbackSlot].callback);
+            animationCallbacks[callbackSlot].callback = sol::function();
+            std::optional<LuaProfiler::Scope> scope;
+            if (_game->getLuaProfiler()->isEnabled())
+            {
+                scope.emplace(*_game->getLuaProfiler(), "animation callback", id + " " + animation->name);
+            }
+            callback();
+        }
 
         if (nextAnimation.empty())
         {
@@ -181,6 +334,65 @@ void SpineObject::onAnimationComplete(std::string key)
     }
 }
 
+std::function<bool()> SpineObject::animationEnded(int trackIndex)
+{
+    spTrackEntry *entry = spAnimationState_getCurrent(skeleton->state, trackIndex);
+    if (!entry)
+    {
+        return []() { return true; };
+    }
+    const float duration = entry->animationEnd - entry->animationStart;
+    float end = duration;
+    if (entry->loop && duration > 0)
+    {
+        end = (std::floor(entry->trackTime / duration) + 1) * duration;
+    }
+    // The entry may be disposed and its memory reused when another animation starts, so it's
+    // recognized by its callback slot, which is only freed and reused after the dispose
+    if (!entry->userData)
+    {
+        setAnimationCallback(entry, sol::function());
+    }
+    void *const slotTag = entry->userData;
+    const int slot = int(reinterpret_cast<intptr_t>(slotTag)) - 1;
+    const unsigned int generation = animationCallbacks[slot].generation;
+    std::weak_ptr<SpineObject> self = getptr();
+    return [self, trackIndex, slotTag, slot, generation, end]()
+    {
+        auto obj = self.lock();
+        if (!obj || obj->animationCallbacks[slot].generation != generation)
+        {
+            return true;
+        }
+        spTrackEntry *current = spAnimationState_getCurrent(obj->skeleton->state, trackIndex);
+        return !current || current->userData != slotTag || current->trackTime >= end;
+    };
+}
+
+sol::table SpineObject::getLuaTable()
+{
+    if (!luaTable.valid())
+    {
+        if (auto _game = game.lock())
+        {
+            luaTable = _game->getLuaTable(id);
+        }
+    }
+    return luaTable;
+}
+
+void SpineObject::saveAnimation(const std::string &animation, bool loop)
+{
+    setLuaField("animation", animation);
+    setLuaField("loop_animation", loop);
+}
+
+void SpineObject::savePosition()
+{
+    setLuaField("x", std::to_string(position.x));
+    setLuaField("y", std::to_string(position.y));
+}
+
 void SpineObject::setSkin(const std::string &skin)
 {
     int resault = spSkeleton_setSkinByName(skeleton->skeleton, skin.c_str());
@@ -199,7 +411,15 @@ void SpineObject::activate()
     }
 }
 
-double SpineObject::getZ()
+void SpineObject::updateZ(const DepthMap *depthMap)
 {
-    return position.y + layer * 2000.0;
+    if (!depthMap || depthMap->empty())
+    {
+        depth = 0;
+        z = position.y + layer * 2000.0;
+        return;
+    }
+    depth = depthMap->sample(position);
+    // The y position only breaks ties where the map is flat, so that the order doesn't flicker
+    z = layer * 2000.0 + depth * 1000.0 + position.y * 0.001;
 }
@@ -1,13 +1,16 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <map>
+#include <unordered_map>
 #include <jngl/Vec2.hpp>
 #include <spine/spine.h>
 #include "skeleton_drawable.hpp"
 #include <sol/sol.hpp>
 
 struct spSkeletonData;
+class DepthMap;
 class Game;
 
 namespace spine
@@ -15,6 +18,32 @@ namespace spine
 	class SkeletonDrawable;
 } // namespace spine
 
+/// Spine event collected while the animation is updated on a worker thread.
+/// Only pointers into the skeleton data are stored, track entries may already be disposed on replay.
+struct QueuedAnimationEvent
+{
+	spEventType type;
+	int trackIndex;
+	bool loop;
+	spAnimation *animation;
+	spEventData *eventData;
+	/// Callback slot of the track entry, -1 if it has none
+	int callbackSlot;
+	/// Generation of the slot when the event fired, older events don't call a newer callback
+	unsigned int callbackGeneration;
+};
+
+/// How much work the animation update of an object may cost
+enum class AnimationDetail
+{
+	/// Pose the skeleton every step
+	Full,
+	/// Pose the skeleton every second step, e.g. for objects far away from the camera
+	HalfRate,
+	/// Only advance the time and fire events, for objects that aren't visible
+	EventsOnly,
+};
+
 /// Basisklasse für die Spine Objekte im Spiel
 class SpineObject : public std::enable_shared_from_this<SpineObject>
 {
@@ -39,6 +68,27 @@ public:
 	jngl::Vec2 getPosition() { return position; }
 	void setPosition(jngl::Vec2 position) { this->position = position; }
 
+	/// The object's state table in Lua, e.g. scenes[scene].items[id]. Looked up once and cached,
+	/// invalid for objects without one.
+	sol::table getLuaTable();
+	void setLuaTable(sol::table table) { luaTable = std::move(table); };
+	/// Forgets the cached table, e.g. after the Lua state was loaded from a savegame
+	void resetLuaTable() { luaTable = sol::table(); };
+	/// Writes a field of the state table, does nothing for objects without one
+	template <class T>
+	void setLuaField(const char *key, T &&value)
+	{
+		sol::table table = getLuaTable();
+		if (table.valid())
+		{
+			table[key] = std::forward<T>(value);
+		}
+	}
+	/// Stores the animation in the state table, so that it's restored with the scene
+	void saveAnimation(const std::string &animation, bool loop);
+	/// Stores the position in the state table
+	void savePosition();
+
 	std::shared_ptr<SpineObject> getParent() { return parent; }
 	void setParent(std::shared_ptr<SpineObject> parent) { this->parent = parent; }
 
@@ -46,7 +96,20 @@ public:
 	void setRotation(float rotation) { this->rotation = rotation; }
 
 	void activate();
-	void setVisible(bool visible){this->visible = visible;}
+	/// Walking because of the player's path or a NavAgent
+	virtual bool isWalking() const { return false; }
+	/// Condition that becomes true when the animation currently playing on the track ends,
+	/// for looped animations at the end of the current loop
+	std::function<bool()> animationEnded(int trackIndex);
+	void setVisible(bool visible)
+	{
+		// The bounds weren't updated while hidden, pose it in the next update
+		if (visible && !this->visible)
+		{
+			stepsWithoutBounds = BOUNDS_REFRESH_STEPS;
+		}
+		this->visible = visible;
+	}
 	bool getVisible(){return visible;}
 
 	std::unique_ptr<spine::SkeletonDrawable> skeleton;
@@ -57,29 +120,72 @@ public:
 	std::optional<jngl::Vec2> getPoint(const std::string &point_name);
 	void playAnimation(int trackIndex, const std::string& currentAnimation, bool loop, sol::function callback);
 	void addAnimation(int trackIndex, const std::string &currentAnimation, bool loop, float delay, sol::function callback);
-	void onAnimationComplete(std::string key);
+	void onAnimationComplete(spAnimation *animation, int callbackSlot, unsigned int callbackGeneration);
     void setSkin(const std::string &skin);
 	std::vector<std::string> getPointNames();
 	bool cross_scene = false;
 	bool abs_position = false;
 
 	static void animationStateListener(spAnimationState *state, spEventType type, spTrackEntry *entry, spEvent *event);
+
+	/// Advances the Spine animation and updates the bounds. Runs on a worker thread,
+	/// Spine events are queued and have to be replayed with dispatchQueuedEvents afterwards.
+	void updateAnimation(float deltaTime, AnimationDetail detail = AnimationDetail::Full);
+	/// Runs the Lua side effects of the events queued by updateAnimation. Main thread only.
+	void dispatchQueuedEvents();
     std::string collision_script = "";  // TODO protected
 	std::string getName(){return spine_name;};
 	std::string getId(){return id;};
-	double getZ();
+	/// Draw order key, updated by updateZ once per step
+	double getZ() const { return z; };
+	/// Recomputes the draw order from the depth map of the scene, or the y position if there is none
+	void updateZ(const DepthMap *depthMap);
+	/// Depth of the position in the zBufferMap, 0 (far) to 1 (near)
+	float getDepth() const { return depth; };
 	int layer = 1;
 	void setDeleted(){deleted = true;};
+	bool isDeleted() const { return deleted; };
 protected:
+	void handleAnimationEvent(const QueuedAnimationEvent &event);
+	/// Compiles the string values of the skeleton's events once, so that firing them doesn't parse Lua
+	void compileEventScripts(sol::state &lua);
+	/// Stores the callback in a free slot and its index in entry->userData
+	void setAnimationCallback(spTrackEntry *entry, sol::function callback);
+	/// Frees the slot when its track entry is disposed
+	void releaseAnimationCallback(int slot);
+
+	bool queueAnimationEvents = false;
+	/// Animation time not applied yet because of AnimationDetail::HalfRate
+	float skippedAnimationTime = 0;
+	/// AnimationDetail::EventsOnly still poses the skeleton and updates the bounds this often, so
+	/// that objects moving into view only by their animation are noticed
+	static constexpr int BOUNDS_REFRESH_STEPS = 10;
+	int stepsWithoutBounds = 0;
+	std::vector<QueuedAnimationEvent> queuedAnimationEvents;
+
 	std::string currentAnimation = "idle";
 	std::string nextAnimation;
-	std::map<std::string, sol::function> animation_callback;
+	struct AnimationCallback
+	{
+		sol::function callback;
+		/// Incremented when the slot is freed
+		unsigned int generation = 0;
+	};
+	/// Callbacks of the track entries, indexed by entry->userData - 1. Slots are reused,
+	/// so that starting and completing animations doesn't allocate.
+	std::vector<AnimationCallback> animationCallbacks;
+	std::vector<int> freeAnimationCallbacks;
+	/// Scripts of the events of skeletonData, inline Lua code or a file in scripts/
+	std::unordered_map<const spEventData *, sol::protected_function> eventScripts;
 	sol::function walk_callback;
 
 	bool deleted = false;
 	bool visible = true;
 	jngl::Vec2 position;
 	float rotation = 0;
+	sol::table luaTable;
+	double z = 0;
+	float depth = 0;
 	std::string spine_name;
 	std::string id;
 	const std::weak_ptr<Game> game;
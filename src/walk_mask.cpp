@@ -0,0 +1,107 @@
+#include "walk_mask.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    /// Fraction of a cell an edge may be away from it and still count as crossing it,
+    /// so that edges along cell borders mark both sides
+    constexpr double EDGE_TOLERANCE = 0.001;
+} // namespace
+
+WalkMask::WalkMask(const std::vector<Polygon> &bounds, const std::vector<Polygon> &polygons, double cellSize,
+                   const std::function<bool(jngl::Vec2)> &inside)
+    : cellSize(std::max(cellSize, 0.1))
+{
+    double minX = std::numeric_limits<double>::infinity();
+    double minY = minX;
+    double maxX = -minX;
+    double maxY = -minX;
+    for (const auto &polygon : bounds)
+    {
+        for (const auto &point : polygon)
+        {
+            minX = std::min(minX, point.x);
+            minY = std::min(minY, point.y);
+            maxX = std::max(maxX, point.x);
+            maxY = std::max(maxY, point.y);
+        }
+    }
+    if (minX > maxX)
+    {
+        return;
+    }
+    origin = jngl::Vec2(minX, minY);
+    columns = int((maxX - minX) / this->cellSize) + 1;
+    rows = int((maxY - minY) / this->cellSize) + 1;
+    this->inside.assign(size_t(columns) * rows, false);
+    edge.assign(size_t(columns) * rows, false);
+
+    for (const auto &polygon : polygons)
+    {
+        for (size_t i = 0; i < polygon.size(); ++i)
+        {
+            markEdge(polygon[i], polygon[(i + 1) % polygon.size()]);
+        }
+    }
+
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            const size_t index = size_t(row) * columns + column;
+            if (!edge[index])
+            {
+                this->inside[index] = inside(origin + jngl::Vec2((column + 0.5) * this->cellSize, (row + 0.5) * this->cellSize));
+            }
+        }
+    }
+}
+
+void WalkMask::markEdge(jngl::Vec2 a, jngl::Vec2 b)
+{
+    // Every cell the segment touches: per row the x range of the part of the segment inside of it
+    const double tolerance = EDGE_TOLERANCE * cellSize;
+    const int firstRow = std::max(0, int(std::floor((std::min(a.y, b.y) - tolerance - origin.y) / cellSize)));
+    const int lastRow = std::min(rows - 1, int(std::floor((std::max(a.y, b.y) + tolerance - origin.y) / cellSize)));
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+        double fromX = std::min(a.x, b.x);
+        double toX = std::max(a.x, b.x);
+        if (a.y != b.y)
+        {
+            const double top = origin.y + row * cellSize - tolerance;
+            const double bottom = top + cellSize + 2 * tolerance;
+            const double t0 = std::clamp((top - a.y) / (b.y - a.y), 0.0, 1.0);
+            const double t1 = std::clamp((bottom - a.y) / (b.y - a.y), 0.0, 1.0);
+            const double x0 = a.x + (b.x - a.x) * t0;
+            const double x1 = a.x + (b.x - a.x) * t1;
+            fromX = std::min(x0, x1);
+            toX = std::max(x0, x1);
+        }
+        const int firstColumn = std::max(0, int(std::floor((fromX - tolerance - origin.x) / cellSize)));
+        const int lastColumn = std::min(columns - 1, int(std::floor((toX + tolerance - origin.x) / cellSize)));
+        for (int column = firstColumn; column <= lastColumn; ++column)
+        {
+            edge[size_t(row) * columns + column] = true;
+        }
+    }
+}
+
+WalkMask::Result WalkMask::lookup(jngl::Vec2 position) const
+{
+    const double x = (position.x - origin.x) / cellSize;
+    const double y = (position.y - origin.y) / cellSize;
+    if (!(x >= 0 && y >= 0 && x < columns && y < rows))
+    {
+        return Result::Outside;
+    }
+    const size_t index = size_t(y) * columns + size_t(x);
+    if (edge[index])
+    {
+        return Result::Unknown;
+    }
+    return inside[index] ? Result::Inside : Result::Outside;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <jngl/Vec2.hpp>
+
+#include <functional>
+#include <vector>
+
+/// Point-in-polygon test rasterized into a bit mask, so that lookups take constant time.
+/// Cells crossed by an edge of the polygons have no answer, there the caller has to test exactly.
+class WalkMask
+{
+public:
+    using Polygon = std::vector<jngl::Vec2>;
+
+    enum class Result
+    {
+        Outside,
+        Inside,
+        /// Close to an edge
+        Unknown,
+    };
+
+    WalkMask() = default;
+    /// Covers the bounding box of bounds. inside is evaluated at the center of every cell that isn't
+    /// crossed by an edge of one of the polygons.
+    WalkMask(const std::vector<Polygon> &bounds, const std::vector<Polygon> &polygons, double cellSize,
+             const std::function<bool(jngl::Vec2)> &inside);
+
+    /// Everything outside of the bounding box is outside
+    Result lookup(jngl::Vec2 position) const;
+
+    bool empty() const { return columns == 0; }
+
+private:
+    void markEdge(jngl::Vec2 a, jngl::Vec2 b);
+
+    jngl::Vec2 origin;
+    double cellSize = 1;
+    int columns = 0;
+    int rows = 0;
+    std::vector<bool> inside;
+    std::vector<bool> edge;
+};
@@ -0,0 +1,223 @@
+// Benchmark of script-heavy actions, to compare the Lua backends (build with -DPAC_USE_LUAJIT=1 for LuaJIT).
+// The scripts do what actions typically do: call bound C++ functions, write object state into the
+// game.scene tables, build strings and wait for frames in coroutines. The last part runs an action
+// of the test scene through Game::runAction, so it needs the data folder and opens a window.
+//
+// Usage: alpaca_lua_benchmark [--quick] [--iterations N]
+
+#include "../src/game.hpp"
+
+#include <jngl.hpp>
+#include <sol/sol.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if (defined(__linux__) && !__has_include(<filesystem>))
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#else
+#include <filesystem>
+namespace fs = std::filesystem;
+#endif
+
+namespace
+{
+    /// Stands in for the engine state the bound functions modify
+    struct Object
+    {
+        double x = 0;
+        double y = 0;
+        std::string animation;
+    };
+
+    const char *const SETUP_SCRIPT = R"(
+        game = { scene = { items = {} } }
+        for i = 1, 100 do
+            game.scene.items["object" .. i] = { x = 0, y = 0, visible = true }
+        end
+        counter = 0
+        function pass() end
+    )";
+
+    /// Like an action script of an interactable object
+    const char *const ACTION_SCRIPT = R"(
+        for i = 1, 100 do
+            local id = "object" .. i
+            local item = game.scene.items[id]
+            item.x = item.x + 1
+            item.y = GetPosition(i) * 0.5
+            item.visible = not item.visible
+            PlayAnimationOn(i, 0, "walk_" .. (i % 4), true, pass)
+        end
+        counter = counter + 1
+    )";
+
+    /// Like an action script waiting for walks or animations
+    const char *const WAITING_SCRIPT = R"(
+        for i = 1, 10 do
+            local item = game.scene.items["object" .. i]
+            item.x = item.x + GetPosition(i)
+            WaitFrames(1)
+        end
+    )";
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(const char *name, double seconds, int iterations)
+    {
+        std::printf("%-34s %10.2f us/iteration\n", name, seconds * 1e6 / iterations);
+    }
+    /// Clicks on the banana of the test scene: Game::runAction loads the script, runs it as a
+    /// coroutine and the player walks there with the following steps
+    int benchmarkEngine(int iterations)
+    {
+        auto dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("../data");
+        if (!fs::exists(dataFolder))
+        {
+            dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("../../data");
+            if (!fs::exists(dataFolder))
+            {
+                dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("data");
+            }
+        }
+        fs::current_path(dataFolder);
+        jngl::showWindow("Lua benchmark", 800, 600, 0, {16, 9}, {16, 9});
+        jngl::writeConfig("savegame", "");
+
+        YAML::Node config = YAML::Load(jngl::readAsset("config/game.json").str());
+        auto game = std::make_shared<Game>(config);
+        game->init();
+        game->step();
+
+        std::shared_ptr<SpineObject> banana = game->getObjectById("banana");
+        if (!banana)
+        {
+            std::printf("The test scene has no banana\n");
+            return EXIT_FAILURE;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            game->step();
+        }
+        const double stepSeconds = secondsSince(start);
+        report("Game::step", stepSeconds, iterations);
+
+        const size_t failed = game->getScriptScheduler()->getFailed();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            game->runAction("banana_clicked", banana);
+            game->step();
+        }
+        report("Game::runAction banana_clicked", secondsSince(start) - stepSeconds, iterations);
+
+        jngl::hideWindow();
+        if (game->getScriptScheduler()->getFailed() != failed)
+        {
+            std::printf("banana_clicked failed\n");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int iterations = 2000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--quick") == 0)
+        {
+            iterations = 50;
+        }
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::atoi(argv[++i]);
+        }
+    }
+
+    sol::state lua;
+    lua.open_libraries(sol::lib::base, sol::lib::package, sol::lib::string, sol::lib::table, sol::lib::math,
+                       sol::lib::coroutine);
+#ifdef SOL_LUAJIT
+    std::printf("Lua backend: LuaJIT\n");
+#else
+    std::printf("Lua backend: %s\n", LUA_RELEASE);
+#endif
+
+    std::vector<Object> objects(101);
+    lua.set_function("GetPosition", [&objects](int index) { return objects.at(index).x++; });
+    lua.set_function("PlayAnimationOn", [&objects](int index, int, const std::string &animation, bool, const sol::function &)
+                     { objects.at(index).animation = animation; });
+    lua.set_function("WaitFrames", sol::yielding([](int) {}));
+    lua.script(SETUP_SCRIPT);
+
+    // Loaded from source every time, like Game::runAction does
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        sol::load_result chunk = lua.load(ACTION_SCRIPT);
+        sol::protected_function action = chunk;
+        if (!action().valid())
+        {
+            std::printf("Action failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+    report("action, compiled every run", secondsSince(start), iterations);
+
+    sol::protected_function action = lua.load(ACTION_SCRIPT);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        action();
+    }
+    report("action, precompiled", secondsSince(start), iterations);
+
+    // Ten coroutines resumed once per frame until all of them are done
+    sol::function waiting = lua.load(WAITING_SCRIPT);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        std::vector<sol::thread> threads;
+        std::vector<sol::coroutine> coroutines;
+        for (int j = 0; j < 10; ++j)
+        {
+            threads.push_back(sol::thread::create(lua.lua_state()));
+            coroutines.emplace_back(threads.back().thread_state(), sol::ref_index(waiting.registry_index()));
+        }
+        bool running = true;
+        while (running)
+        {
+            running = false;
+            for (auto &coroutine : coroutines)
+            {
+                if (coroutine.runnable())
+                {
+                    coroutine();
+                    running = true;
+                }
+            }
+        }
+    }
+    report("10 waiting coroutines", secondsSince(start), iterations);
+
+    const int counter = lua["counter"];
+    if (counter != 2 * iterations)
+    {
+        std::printf("Expected %d runs, got %d\n", 2 * iterations, counter);
+        return EXIT_FAILURE;
+    }
+
+    return benchmarkEngine(iterations);
+}
@@ -0,0 +1,285 @@
+// Benchmark and fuzz test for the navmesh behind Background::getPathToTarget.
+// Synthesizes walkable areas of increasing size with and without holes, searches paths between
+// random walkable points, reports latency and memory and checks that every path stays walkable.
+//
+// Usage: alpaca_pathfinding_benchmark [--quick] [--queries N] [--seed N]
+
+#include "../src/navmesh.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using Polygon = NavMesh::Polygon;
+
+    constexpr double PI = 3.14159265358979323846;
+
+    struct Scene
+    {
+        Polygon area;
+        std::vector<Polygon> holes;
+    };
+
+    double cross(jngl::Vec2 a, jngl::Vec2 b, jngl::Vec2 c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    bool containsPoint(const Polygon &polygon, jngl::Vec2 point)
+    {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+        {
+            const auto &a = polygon[i];
+            const auto &b = polygon[j];
+            if ((a.y > point.y) != (b.y > point.y) && point.x < (b.x - a.x) * (point.y - a.y) / (b.y - a.y) + a.x)
+            {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    double distanceToSegment(jngl::Vec2 a, jngl::Vec2 b, jngl::Vec2 point)
+    {
+        const double lengthSquared = (b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y);
+        double t = lengthSquared > 0 ? ((point.x - a.x) * (b.x - a.x) + (point.y - a.y) * (b.y - a.y)) / lengthSquared : 0;
+        t = std::clamp(t, 0.0, 1.0);
+        return std::hypot(a.x + t * (b.x - a.x) - point.x, a.y + t * (b.y - a.y) - point.y);
+    }
+
+    double distanceToBorder(const Polygon &polygon, jngl::Vec2 point)
+    {
+        double result = INFINITY;
+        for (size_t i = 0; i < polygon.size(); ++i)
+        {
+            result = std::min(result, distanceToSegment(polygon[i], polygon[(i + 1) % polygon.size()], point));
+        }
+        return result;
+    }
+
+    bool isWalkable(const Scene &scene, jngl::Vec2 point)
+    {
+        if (!containsPoint(scene.area, point))
+        {
+            return false;
+        }
+        return std::none_of(scene.holes.begin(), scene.holes.end(), [&point](const Polygon &hole) { return containsPoint(hole, point); });
+    }
+
+    /// Walkable or on the border
+    bool isWalkableOrBorder(const Scene &scene, jngl::Vec2 point)
+    {
+        constexpr double TOLERANCE = 0.01;
+        if (distanceToBorder(scene.area, point) < TOLERANCE)
+        {
+            return true;
+        }
+        for (const auto &hole : scene.holes)
+        {
+            if (distanceToBorder(hole, point) < TOLERANCE)
+            {
+                return true;
+            }
+        }
+        return isWalkable(scene, point);
+    }
+
+    /// Crossing, touching doesn't count
+    bool properlyIntersect(jngl::Vec2 a, jngl::Vec2 b, jngl::Vec2 c, jngl::Vec2 d)
+    {
+        constexpr double EPSILON = 1e-6;
+        const double d1 = cross(c, d, a);
+        const double d2 = cross(c, d, b);
+        const double d3 = cross(a, b, c);
+        const double d4 = cross(a, b, d);
+        return ((d1 > EPSILON && d2 < -EPSILON) || (d1 < -EPSILON && d2 > EPSILON)) &&
+               ((d3 > EPSILON && d4 < -EPSILON) || (d3 < -EPSILON && d4 > EPSILON));
+    }
+
+    bool crossesBorder(const Polygon &polygon, jngl::Vec2 a, jngl::Vec2 b)
+    {
+        for (size_t i = 0; i < polygon.size(); ++i)
+        {
+            if (properlyIntersect(a, b, polygon[i], polygon[(i + 1) % polygon.size()]))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool segmentIsWalkable(const Scene &scene, jngl::Vec2 a, jngl::Vec2 b)
+    {
+        if (crossesBorder(scene.area, a, b) ||
+            std::any_of(scene.holes.begin(), scene.holes.end(), [&](const Polygon &hole) { return crossesBorder(hole, a, b); }))
+        {
+            return false;
+        }
+        // Catches segments running through a hole from corner to corner
+        for (double t : {0.25, 0.5, 0.75})
+        {
+            if (!isWalkableOrBorder(scene, jngl::Vec2(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y))))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Star shaped room around the origin, like a walkable_area with many corners
+    Scene makeScene(size_t vertexCount, size_t holeCount, std::mt19937 &random)
+    {
+        Scene scene;
+        std::uniform_real_distribution<double> radius(600, 1000);
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            const double angle = 2 * PI * double(i) / double(vertexCount);
+            const double r = radius(random);
+            scene.area.emplace_back(r * std::cos(angle), r * std::sin(angle) * 0.5);
+        }
+
+        // Small obstacles inside of the inner radius that don't overlap each other
+        std::uniform_real_distribution<double> position(-450, 450);
+        std::uniform_real_distribution<double> size(15, 40);
+        std::uniform_int_distribution<int> corners(3, 8);
+        for (size_t attempt = 0; scene.holes.size() < holeCount && attempt < holeCount * 20; ++attempt)
+        {
+            const jngl::Vec2 center(position(random), position(random) * 0.5);
+            const double r = size(random);
+            const bool free = std::all_of(scene.holes.begin(), scene.holes.end(), [&](const Polygon &hole)
+                                          { return std::hypot(hole.front().x - center.x, hole.front().y - center.y) > 2 * r + 100; });
+            if (!free || std::abs(center.x) / 550 + std::abs(center.y) / 275 > 1)
+            {
+                continue;
+            }
+            Polygon hole;
+            const int count = corners(random);
+            for (int i = 0; i < count; ++i)
+            {
+                const double angle = 2 * PI * i / count;
+                hole.emplace_back(center.x + r * std::cos(angle), center.y + r * std::sin(angle));
+            }
+            scene.holes.push_back(std::move(hole));
+        }
+        return scene;
+    }
+
+    jngl::Vec2 randomWalkablePoint(const Scene &scene, std::mt19937 &random)
+    {
+        std::uniform_real_distribution<double> x(-1000, 1000);
+        std::uniform_real_distribution<double> y(-500, 500);
+        while (true)
+        {
+            const jngl::Vec2 point(x(random), y(random));
+            if (isWalkable(scene, point))
+            {
+                return point;
+            }
+        }
+    }
+
+    double percentile(std::vector<double> &values, double p)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+        const size_t index = std::min(values.size() - 1, size_t(p * double(values.size())));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t queries = 5000;
+    unsigned int seed = 42;
+    std::vector<size_t> vertexCounts = {16, 64, 256, 1024};
+    std::vector<size_t> holeCounts = {0, 4, 12};
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--quick") == 0)
+        {
+            queries = 300;
+            vertexCounts = {16, 128};
+            holeCounts = {0, 8};
+        }
+        else if (std::strcmp(argv[i], "--queries") == 0 && i + 1 < argc)
+        {
+            queries = std::stoul(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = unsigned(std::stoul(argv[++i]));
+        }
+    }
+
+    std::mt19937 random(seed);
+    size_t failures = 0;
+    std::printf("%8s %6s %10s %10s %10s %10s %10s %8s\n", "vertices", "holes", "build ms", "p50 us", "p99 us", "max us", "mesh KiB", "no path");
+    for (size_t vertexCount : vertexCounts)
+    {
+        for (size_t holeCount : holeCounts)
+        {
+            const Scene scene = makeScene(vertexCount, holeCount, random);
+
+            const auto buildStart = std::chrono::steady_clock::now();
+            NavMesh navMesh({scene.area}, scene.holes);
+            const double buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+            std::vector<double> latencies;
+            latencies.reserve(queries);
+            size_t unreachable = 0;
+            for (size_t query = 0; query < queries; ++query)
+            {
+                const jngl::Vec2 start = randomWalkablePoint(scene, random);
+                const jngl::Vec2 target = randomWalkablePoint(scene, random);
+
+                const auto queryStart = std::chrono::steady_clock::now();
+                const auto path = navMesh.findPath(start, target);
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - queryStart).count());
+
+                // The holes don't touch, so every walkable point can reach every other one
+                if (path.empty())
+                {
+                    ++unreachable;
+                    ++failures;
+                    std::printf("no path from %f, %f to %f, %f\n", start.x, start.y, target.x, target.y);
+                    continue;
+                }
+                for (size_t i = 1; i < path.size(); ++i)
+                {
+                    if (!segmentIsWalkable(scene, path[i - 1], path[i]))
+                    {
+                        ++failures;
+                        std::printf("path from %f, %f to %f, %f leaves the walkable area between %f, %f and %f, %f\n", start.x,
+                                    start.y, target.x, target.y, path[i - 1].x, path[i - 1].y, path[i].x, path[i].y);
+                        break;
+                    }
+                }
+            }
+
+            const double maximum = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end());
+            const double p50 = percentile(latencies, 0.5);
+            const double p99 = percentile(latencies, 0.99);
+            std::printf("%8zu %6zu %10.2f %10.1f %10.1f %10.1f %10.1f %8zu\n", vertexCount, scene.holes.size(), buildTime, p50, p99,
+                        maximum, navMesh.getMemoryUsage() / 1024.0, unreachable);
+        }
+    }
+
+    if (failures > 0)
+    {
+        std::printf("%zu failures\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
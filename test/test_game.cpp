@@ -9,8 +9,10 @@
 #include <jngl/input.hpp>
 #include <jngl/job.hpp>
 
+#include "../src/allocation_counter.hpp"
 #include "../src/game.hpp"
 #include "../src/interactable_object.hpp"
+#include "../src/skeleton_drawable.hpp"
 
 #ifndef EMSCRIPTEN
 #if (defined(__linux__) && !__has_include(<filesystem>))
@@ -227,4 +229,273 @@ suite alpaca_test_suite = [] {
     expect(neq(i, 3000));
 };
 
+#ifndef EMSCRIPTEN
+// Every script has to compile and run with the Lua backend the game was built with (Lua or LuaJIT)
+"lua_scripts_test"_test = []
+{
+#ifndef ANDROID
+    auto dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("../data");
+    if (!fs::exists(dataFolder))
+    {
+        dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("../../data");
+        if (!fs::exists(dataFolder))
+        {
+            dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("data");
+        }
+    }
+    fs::current_path(dataFolder);
+#endif
+    jngl::showWindow("Test", 800, 600, 0, {16, 9}, {16, 9});
+
+    jngl::writeConfig("savegame", "");
+
+    YAML::Node config = YAML::Load(jngl::readAsset("config/game.json").str());
+    auto game = std::make_shared<Game>(config);
+
+    game->init();
+    game->step();
+
+#ifdef SOL_LUAJIT
+    jngl::debugLn("Lua backend: LuaJIT");
+#else
+    jngl::debugLn(std::string("Lua backend: ") + LUA_RELEASE);
+#endif
+
+    for (const auto &entry : fs::directory_iterator("scripts"))
+    {
+        if (entry.path().extension() != ".lua")
+        {
+            continue;
+        }
+        const std::string name = entry.path().stem().string();
+        jngl::debugLn("RUN: " + name);
+
+        sol::load_result chunk = game->lua_state->load(jngl::readAsset("scripts/" + name + ".lua").str());
+        expect(chunk.valid()) << name << "doesn't compile";
+
+        // Run it like a click on the object with the bounding box of the same name would,
+        // scripts of the scene itself get the background
+        std::shared_ptr<SpineObject> thisObject = game->currentScene->background;
+        for (const auto &obj : game->gameObjects)
+        {
+            if (!obj->bounds || !obj->bounds->boundingBoxes)
+            {
+                continue;
+            }
+            for (int j = 0; j < obj->bounds->count; j++)
+            {
+                if (name == obj->bounds->boundingBoxes[j]->super.super.name)
+                {
+                    thisObject = obj;
+                }
+            }
+        }
+
+        const size_t failed = game->getScriptScheduler()->getFailed();
+        game->runAction(name, thisObject);
+        for (int i = 0; i < 400; i++)
+        {
+            game->step();
+            if (game->getDialogManager()->isActive())
+            {
+                game->getDialogManager()->continueCurrent();
+            }
+        }
+        expect(eq(game->getScriptScheduler()->getFailed(), failed)) << name << "failed to run";
+    }
+
+    jngl::hideWindow();
+};
+
+"steady_state_allocations_test"_test = []
+{
+    if (!isAllocationCounterEnabled())
+    {
+        jngl::debugLn("Skipped, build with PAC_COUNT_ALLOCATIONS");
+        return;
+    }
+#ifndef ANDROID
+    auto dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("../data");
+    if (!fs::exists(dataFolder))
+    {
+        dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("../../data");
+        if (!fs::exists(dataFolder))
+        {
+            dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("data");
+        }
+    }
+    fs::current_path(dataFolder);
+#endif
+    jngl::showWindow("Test", 800, 600, 0, {16, 9}, {16, 9});
+
+    jngl::writeConfig("savegame", "");
+
+    YAML::Node config = YAML::Load(jngl::readAsset("config/game.json").str());
+    auto game = std::make_shared<Game>(config);
+
+    game->init();
+
+    // Caches, pools and the scene's objects are filled during the first frames
+    for (int i = 0; i < 200; i++)
+    {
+        game->step();
+        game->draw();
+    }
+
+    // Nothing happens in the scene without input, so every frame looks the same
+    const size_t allocationsBefore = getGlobalAllocationCount();
+    for (int i = 0; i < 100; i++)
+    {
+        game->step();
+        game->draw();
+    }
+    expect(eq(getGlobalAllocationCount() - allocationsBefore, size_t(0)));
+
+    // Walk to the triangle furthest away, so that the player has to turn at corners
+    auto navMesh = game->currentScene->background->getNavMesh();
+    expect(navMesh && !navMesh->getTriangles().empty()) << "The scene has no navmesh";
+    if (!navMesh || navMesh->getTriangles().empty())
+    {
+        jngl::hideWindow();
+        return;
+    }
+    const jngl::Vec2 start = game->player->getPosition();
+    jngl::Vec2 target = start;
+    for (const auto &triangle : navMesh->getTriangles())
+    {
+        const auto &vertices = navMesh->getVertices();
+        const jngl::Vec2 centroid = (vertices[triangle.vertices[0]] + vertices[triangle.vertices[1]] +
+                                     vertices[triangle.vertices[2]]) * (1.0 / 3);
+        if (boost::qvm::dot(centroid - start, centroid - start) > boost::qvm::dot(target - start, target - start))
+        {
+            target = centroid;
+        }
+    }
+
+    // The frames that request the path allocate the job, its continuation and the result,
+    // only the frames spent walking are measured
+    game->player->addTargetPositionImmediately(target, (*game->lua_state)["pass"]);
+    for (int i = 0; i < 100 && game->player->getPosition() == start; i++)
+    {
+        game->step();
+        game->draw();
+    }
+    expect(game->player->isWalking()) << "The player didn't start walking";
+
+    const size_t walkingAllocationsBefore = getGlobalAllocationCount();
+    for (int i = 0; i < 100 && game->player->isWalking(); i++)
+    {
+        game->step();
+        game->draw();
+    }
+    expect(eq(getGlobalAllocationCount() - walkingAllocationsBefore, size_t(0))) << "while walking";
+
+    // An action that waits, the first resume creates the coroutine
+    sol::protected_function action = game->lua_state->load("for i = 1, 1000 do WaitFrames(1) end");
+    game->getScriptScheduler()->run(*game->lua_state, action, sol::lua_nil, "Wait action failed");
+    for (int i = 0; i < 10; i++)
+    {
+        game->step();
+        game->draw();
+    }
+
+    const size_t actionAllocationsBefore = getGlobalAllocationCount();
+    for (int i = 0; i < 100; i++)
+    {
+        game->step();
+        game->draw();
+    }
+    expect(eq(getGlobalAllocationCount() - actionAllocationsBefore, size_t(0))) << "while an action waits";
+
+    jngl::hideWindow();
+};
+#endif
+
+"skeleton_advance_events_test"_test = []
+{
+#ifdef EMSCRIPTEN
+    chdir("data");
+#elif !defined(ANDROID)
+    auto dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("../data");
+    if (!fs::exists(dataFolder))
+    {
+        dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("../../data");
+        if (!fs::exists(dataFolder))
+        {
+            dataFolder = fs::path(jngl::getBinaryPath()) / fs::path("data");
+        }
+    }
+    fs::current_path(dataFolder);
+#endif
+    jngl::showWindow("Test", 800, 600, 0, {16, 9}, {16, 9});
+
+    spAtlas *atlas = spAtlas_createFromFile("spineboy-pro/spineboy-pro.atlas", nullptr);
+    spSkeletonJson *json = spSkeletonJson_create(atlas);
+    spSkeletonData *skeletonData = spSkeletonJson_readSkeletonDataFile(json, "spineboy-pro/spineboy-pro.json");
+    spSkeletonJson_dispose(json);
+    expect(skeletonData != nullptr) << "Couldn't load spineboy-pro";
+    if (!skeletonData)
+    {
+        spAtlas_dispose(atlas);
+        jngl::hideWindow();
+        return;
+    }
+
+    // Records "<frame> <event name>" and "<frame> complete <animation>" per skeleton
+    struct Recorder
+    {
+        std::vector<std::string> fired;
+        int frame = 0;
+    };
+    const auto listener = [](spAnimationState *state, spEventType type, spTrackEntry *entry, spEvent *event)
+    {
+        auto recorder = static_cast<Recorder *>(state->userData);
+        if (type == SP_ANIMATION_EVENT)
+        {
+            recorder->fired.push_back(std::to_string(recorder->frame) + " " + event->data->name);
+        }
+        else if (type == SP_ANIMATION_COMPLETE)
+        {
+            recorder->fired.push_back(std::to_string(recorder->frame) + " complete " + entry->animation->name);
+        }
+    };
+
+    Recorder updatedRecorder;
+    Recorder advancedRecorder;
+    {
+        spine::SkeletonDrawable updated(skeletonData);
+        spine::SkeletonDrawable advanced(skeletonData);
+        updated.state->userData = &updatedRecorder;
+        advanced.state->userData = &advancedRecorder;
+        updated.state->listener = listener;
+        advanced.state->listener = listener;
+        // Mixing keeps the previous animation running, so its completion is reported too
+        updated.state->data->defaultMix = 0.2f;
+        advanced.state->data->defaultMix = 0.2f;
+
+        // A looping animation with an event on its first key, one that completes once and
+        // a loop that is mixed in
+        for (const auto &[animation, loop] :
+             {std::pair("walk", true), std::pair("jump", false), std::pair("run", true)})
+        {
+            spAnimationState_setAnimationByName(updated.state, 0, animation, loop);
+            spAnimationState_setAnimationByName(advanced.state, 0, animation, loop);
+            for (int i = 0; i < 150; i++)
+            {
+                updated.update(1.f / 60);
+                advanced.advance(1.f / 60);
+                updatedRecorder.frame++;
+                advancedRecorder.frame++;
+            }
+        }
+    }
+
+    expect(!updatedRecorder.fired.empty()) << "spineboy-pro fired no events";
+    expect(updatedRecorder.fired == advancedRecorder.fired);
+
+    spSkeletonData_dispose(skeletonData);
+    spAtlas_dispose(atlas);
+    jngl::hideWindow();
+};
+
 };
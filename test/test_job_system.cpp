@@ -0,0 +1,143 @@
+#include <boost/ut.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "../src/job_system.hpp"
+
+using namespace boost::ut;
+suite job_system_test_suite = [] {
+
+"parallel_for_test"_test = []
+{
+    for (size_t workers : {0, 1, 4})
+    {
+        JobSystem jobSystem(workers);
+        std::vector<int> values(10000, 0);
+        jobSystem.parallelFor(values.size(), [&values](size_t i) { values[i] += int(i); }, 64);
+
+        std::vector<int> expected(values.size());
+        std::iota(expected.begin(), expected.end(), 0);
+        expect(values == expected);
+
+        // Nested calls must not deadlock, the waiting worker helps out
+        std::atomic<int> nested(0);
+        jobSystem.parallelFor(8, [&](size_t) { jobSystem.parallelFor(8, [&](size_t) { ++nested; }); });
+        expect(eq(nested.load(), 64));
+
+        expect(throws<std::runtime_error>([&jobSystem]
+        {
+            jobSystem.parallelFor(100, [](size_t i)
+            {
+                if (i == 50)
+                {
+                    throw std::runtime_error("job failed");
+                }
+            });
+        }));
+    }
+};
+
+"task_group_and_future_test"_test = []
+{
+    JobSystem jobSystem(4);
+
+    std::atomic<int> counter(0);
+    TaskGroup group(jobSystem);
+    for (int i = 0; i < 1000; ++i)
+    {
+        group.run([&counter]() { ++counter; });
+    }
+    group.wait();
+    expect(eq(counter.load(), 1000));
+
+    auto future = jobSystem.submit([]() { return 42; });
+    expect(eq(jobSystem.wait(future), 42));
+
+    // Continuations only run when the main thread asks for them
+    int result = 0;
+    jobSystem.submitThen([]() { return 7; }, [&result](std::exception_ptr, int value) { result = value; });
+    while (result == 0)
+    {
+        jobSystem.runMainThreadJobs();
+    }
+    expect(eq(result, 7));
+
+    // Exceptions of the work are passed to the continuation instead of terminating the worker
+    bool failed = false;
+    bool done = false;
+    jobSystem.submitThen([]() -> int { throw std::runtime_error("work"); },
+                         [&failed](std::exception_ptr error, int) { failed = error != nullptr; });
+    jobSystem.submitThen([]() {}, [&done](std::exception_ptr error) { done = error == nullptr; });
+    while (!failed || !done)
+    {
+        jobSystem.runMainThreadJobs();
+    }
+    expect(failed);
+    expect(done);
+};
+
+"main_thread_exception_test"_test = []
+{
+    JobSystem jobSystem(0);
+
+    std::vector<int> calls;
+    jobSystem.runOnMainThread([&calls]() { calls.push_back(1); });
+    jobSystem.runOnMainThread([&calls]() { calls.push_back(2); throw std::runtime_error("main"); });
+    jobSystem.runOnMainThread([&calls]() { calls.push_back(3); });
+    expect(throws([&jobSystem]() { jobSystem.runMainThreadJobs(); }));
+    expect(eq(calls.size(), size_t(2)));
+
+    // The ones after the failed function run next, before newer ones, and nothing runs twice
+    jobSystem.runOnMainThread([&calls]() { calls.push_back(4); });
+    jobSystem.runMainThreadJobs();
+    jobSystem.runMainThreadJobs();
+    expect(calls == std::vector<int>{1, 2, 3, 4});
+};
+
+"shutdown_test"_test = []
+{
+    std::atomic<int> jobs(0);
+    int continuations = 0;
+    {
+        JobSystem jobSystem(2);
+        for (int i = 0; i < 100; ++i)
+        {
+            jobSystem.submitThen(
+                [&jobSystem, &jobs]()
+                {
+                    // Jobs queued by jobs during the shutdown still run
+                    jobSystem.submitThen([&jobs]() { ++jobs; }, [](std::exception_ptr) {});
+                    ++jobs;
+                },
+                [&continuations](std::exception_ptr error) { continuations += error == nullptr; });
+        }
+    }
+    expect(eq(jobs.load(), 200));
+    expect(eq(continuations, 100));
+};
+
+"scheduling_overhead_test"_test = []
+{
+    JobSystem jobSystem;
+    const size_t JOBS = 100000;
+    std::atomic<size_t> done(0);
+
+    const auto start = std::chrono::steady_clock::now();
+    TaskGroup group(jobSystem);
+    for (size_t i = 0; i < JOBS; ++i)
+    {
+        group.run([&done]() { ++done; });
+    }
+    group.wait();
+    const auto duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+
+    std::cout << "JobSystem with " << jobSystem.getWorkerCount() << " workers: "
+              << duration.count() / JOBS << " ns per empty job" << std::endl;
+    expect(eq(done.load(), JOBS));
+};
+
+};
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <boost/ut.hpp>
+#include <cmath>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "../src/navmesh.hpp"
+
+using namespace boost::ut;
+
+namespace
+{
+    bool near(jngl::Vec2 a, jngl::Vec2 b)
+    {
+        return std::abs(a.x - b.x) < 0.001 && std::abs(a.y - b.y) < 0.001;
+    }
+
+    bool samePath(const std::deque<jngl::Vec2> &path, const std::vector<jngl::Vec2> &expected)
+    {
+        if (path.size() != expected.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < path.size(); ++i)
+        {
+            if (!near(path[i], expected[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+
+suite navmesh_test_suite = [] {
+
+"navmesh_l_shape_test"_test = []
+{
+    const NavMesh::Polygon room = {{0, 0}, {100, 0}, {100, 40}, {40, 40}, {40, 100}, {0, 100}};
+    NavMesh navMesh({room}, {});
+    expect(eq(navMesh.getTriangles().size(), size_t(4)));
+
+    // The path bends around the inner corner
+    expect(samePath(navMesh.findPath({90, 20}, {20, 90}), {{90, 20}, {40, 40}, {20, 90}}));
+    expect(samePath(navMesh.findPath({20, 90}, {90, 20}), {{20, 90}, {40, 40}, {90, 20}}));
+    // Straight line inside of one area
+    expect(samePath(navMesh.findPath({10, 10}, {90, 10}), {{10, 10}, {90, 10}}));
+};
+
+"navmesh_holes_test"_test = []
+{
+    // Closing vertex repeated like the corners of the walkable_area, winding order of the hole reversed
+    const NavMesh::Polygon room = {{0, 0}, {100, 0}, {100, 100}, {0, 100}, {0, 0}};
+    const NavMesh::Polygon table = {{40, 40}, {40, 60}, {60, 60}, {60, 40}};
+    NavMesh navMesh({room}, {table});
+
+    expect(eq(navMesh.findTriangle({50, 50}), -1));
+    expect(navMesh.findTriangle({10, 50}) >= 0);
+    expect(samePath(navMesh.findPath({50, 10}, {50, 90}), {{50, 10}, {40, 40}, {40, 60}, {50, 90}}) ||
+           samePath(navMesh.findPath({50, 10}, {50, 90}), {{50, 10}, {60, 40}, {60, 60}, {50, 90}}));
+    expect(samePath(navMesh.findPath({42, 5}, {42, 95}), {{42, 5}, {40, 40}, {40, 60}, {42, 95}}));
+};
+
+"navmesh_obstacles_test"_test = []
+{
+    const NavMesh::Polygon room = {{0, 0}, {100, 0}, {100, 100}, {0, 100}};
+    const NavMesh::Polygon island = {{200, 0}, {300, 0}, {300, 100}, {200, 100}};
+    NavMesh navMesh({room, island}, {});
+    expect(samePath(navMesh.findPath({42, 10}, {42, 90}), {{42, 10}, {42, 90}}));
+
+    const NavMesh::Polygon box = {{40, 40}, {60, 40}, {60, 60}, {40, 60}};
+    NavMesh blocked(navMesh, {box});
+    expect(neq(blocked.getVersion(), navMesh.getVersion()));
+    expect(eq(blocked.findTriangle({50, 50}), -1));
+    expect(samePath(blocked.findPath({42, 10}, {42, 90}), {{42, 10}, {40, 40}, {40, 60}, {42, 90}}));
+    expect(samePath(blocked.findPath({210, 10}, {290, 90}), {{210, 10}, {290, 90}}));
+
+    // Overlapping obstacles are merged, obstacles crossing the border are ignored
+    const NavMesh::Polygon overlapping = {{55, 55}, {75, 55}, {75, 75}, {55, 75}};
+    const NavMesh::Polygon outside = {{-10, 40}, {20, 40}, {20, 60}, {-10, 60}};
+    NavMesh merged(blocked, {box, overlapping, outside});
+    expect(eq(merged.findTriangle({50, 50}), -1));
+    expect(eq(merged.findTriangle({65, 65}), -1));
+    expect(merged.findTriangle({5, 50}) >= 0);
+
+    // Removing the obstacles frees the way again
+    NavMesh cleared(merged, {});
+    expect(samePath(cleared.findPath({42, 10}, {42, 90}), {{42, 10}, {42, 90}}));
+};
+
+"navmesh_local_obstacle_test"_test = []
+{
+    // Long corridor with a wavy border, so that it has many triangles
+    NavMesh::Polygon corridor;
+    for (int x = 0; x <= 1000; x += 50)
+    {
+        corridor.emplace_back(x, (x / 50) % 2 == 0 ? 0 : 10);
+    }
+    for (int x = 1000; x >= 0; x -= 50)
+    {
+        corridor.emplace_back(x, (x / 50) % 2 == 0 ? 100 : 90);
+    }
+    NavMesh navMesh({corridor}, {});
+
+    const NavMesh::Polygon box = {{40, 40}, {60, 40}, {60, 60}, {40, 60}};
+    NavMesh blocked(navMesh, {box});
+    expect(eq(blocked.findTriangle({50, 50}), -1));
+    expect(samePath(blocked.findPath({900, 50}, {990, 50}), {{900, 50}, {990, 50}}));
+
+    // Triangles far away from the obstacle are kept as they are
+    auto corners = [](const NavMesh &mesh, const NavMesh::Triangle &triangle)
+    {
+        std::vector<std::pair<double, double>> result;
+        for (int index : triangle.vertices)
+        {
+            result.emplace_back(mesh.getVertices()[index].x, mesh.getVertices()[index].y);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    size_t far = 0;
+    size_t kept = 0;
+    for (const auto &triangle : navMesh.getTriangles())
+    {
+        if (navMesh.getVertices()[triangle.vertices[0]].x < 300)
+        {
+            continue;
+        }
+        ++far;
+        const auto expected = corners(navMesh, triangle);
+        for (const auto &other : blocked.getTriangles())
+        {
+            if (corners(blocked, other) == expected)
+            {
+                ++kept;
+                break;
+            }
+        }
+    }
+    expect(far > 0);
+    expect(eq(kept, far));
+};
+
+"navmesh_grid_lookup_test"_test = []
+{
+    // Many small triangles, so that the grid has many cells
+    NavMesh::Polygon star;
+    for (int i = 0; i < 64; ++i)
+    {
+        const double angle = 2 * M_PI * i / 64;
+        const double radius = i % 2 == 0 ? 500 : 300;
+        star.emplace_back(std::round(radius * std::cos(angle)), std::round(radius * std::sin(angle)));
+    }
+    NavMesh navMesh({star}, {{{-20, -20}, {20, -20}, {20, 20}, {-20, 20}}});
+
+    // Same result as testing every triangle
+    for (int x = -600; x <= 600; x += 13)
+    {
+        for (int y = -600; y <= 600; y += 17)
+        {
+            const jngl::Vec2 position(x, y);
+            int expected = -1;
+            for (size_t t = 0; t < navMesh.getTriangles().size() && expected < 0; ++t)
+            {
+                const auto &v = navMesh.getTriangles()[t].vertices;
+                const auto &a = navMesh.getVertices()[v[0]];
+                const auto &b = navMesh.getVertices()[v[1]];
+                const auto &c = navMesh.getVertices()[v[2]];
+                auto side = [&position](jngl::Vec2 p, jngl::Vec2 q)
+                { return (q.x - p.x) * (position.y - p.y) - (q.y - p.y) * (position.x - p.x); };
+                if (side(a, b) >= -1e-6 && side(b, c) >= -1e-6 && side(c, a) >= -1e-6)
+                {
+                    expected = int(t);
+                }
+            }
+            expect(eq(navMesh.findTriangle(position), expected));
+        }
+    }
+
+    // Far outside of the grid, snapped to the closest triangle
+    const auto path = navMesh.findPath({0, 3000}, {0, 400});
+    expect(eq(path.size(), size_t(2)));
+};
+
+"navmesh_islands_test"_test = []
+{
+    const NavMesh::Polygon room = {{0, 0}, {100, 0}, {100, 100}, {0, 100}};
+    const NavMesh::Polygon island = {{200, 0}, {300, 0}, {300, 100}};
+    NavMesh navMesh({room, island}, {});
+
+    expect(navMesh.findPath({10, 10}, {280, 20}).empty());
+    expect(samePath(navMesh.findPath({210, 5}, {290, 80}), {{210, 5}, {290, 80}}));
+};
+
+};